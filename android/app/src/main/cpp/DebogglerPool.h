@@ -0,0 +1,61 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "ProcessImage.h"
+
+// Deboggler instances for callers on any thread (the camera frames and the batch images).
+// acquire() hands out an idle instance, or a copy of the prototype when they are all busy, and the lease gives it
+// back when destroyed: an instance keeps its workspace from one frame to the next and is never used by two threads
+// at once. configure() changes the prototype; the instances made before are dropped when they come back.
+struct DebogglerPool {
+    struct Lease {
+        DebogglerPool &pool;
+        std::unique_ptr<Deboggler> deboggler;
+        unsigned generation;
+
+        Lease(DebogglerPool &pool, std::unique_ptr<Deboggler> deboggler, unsigned generation)
+                : pool(pool), deboggler(std::move(deboggler)), generation(generation) {}
+
+        Lease(const Lease &) = delete;
+        Lease &operator=(const Lease &) = delete;
+
+        ~Lease() { pool.release(std::move(deboggler), generation); }
+
+        Deboggler &operator*() const { return *deboggler; }
+
+        Deboggler *operator->() const { return deboggler.get(); }
+    };
+
+    Lease acquire() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (idle.empty())
+            return {*this, std::make_unique<Deboggler>(prototype), generation};
+        auto deboggler = std::move(idle.back());
+        idle.pop_back();
+        return {*this, std::move(deboggler), generation};
+    }
+
+    // function(Deboggler &) sets up the prototype the next instances are copied from
+    template<typename Function>
+    void configure(Function &&function) {
+        std::lock_guard<std::mutex> lock(mutex);
+        function(prototype);
+        idle.clear();
+        generation++;
+    }
+
+private:
+    std::mutex mutex;
+    Deboggler prototype;
+    std::vector<std::unique_ptr<Deboggler>> idle;
+    unsigned generation = 0;
+
+    void release(std::unique_ptr<Deboggler> deboggler, unsigned leaseGeneration) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (leaseGeneration == generation)
+            idle.push_back(std::move(deboggler));
+    }
+};
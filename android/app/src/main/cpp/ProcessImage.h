@@ -1,7 +1,11 @@
 #pragma once
 
 #include <opencv2/imgcodecs.hpp>
+#include "Quadrilateral.h"
+#include "Segmentation.h"
 #include "/Library/dev/rsahel/deboggler-repo/src/neuralnetwork/neuralnetwork.h"
+#include "neuralnetwork/classifier.h"
+#include "neuralnetwork/quantized.h"
 
 enum class ProcessResult {
     DicesNotFound,
@@ -39,22 +43,11 @@ static void validateROIFor(cv::Rect &rect, const cv::Mat &src) {
 }
 
 static cv::RotatedRect mergeRotatedRect(cv::RotatedRect &r1, cv::RotatedRect &r2) {
-    static vector<Point2f> allpts;
-    allpts.clear();
-
-    static Point2f p1[4];
-    r1.points(p1);
-    allpts.push_back(p1[0]);
-    allpts.push_back(p1[1]);
-    allpts.push_back(p1[2]);
-    allpts.push_back(p1[3]);
-    r2.points(p1);
-    allpts.push_back(p1[0]);
-    allpts.push_back(p1[1]);
-    allpts.push_back(p1[2]);
-    allpts.push_back(p1[3]);
-
-    auto item = minAreaRect(allpts);
+    Point2f allpts[8];
+    r1.points(allpts);
+    r2.points(allpts + 4);
+
+    auto item = minAreaRect(cv::Mat(8, 1, CV_32FC2, allpts));
     return item;
 }
 
@@ -76,90 +69,181 @@ static void drawCorners(cv::Mat &src, cv::Mat &mask, cv::Point2f *orderedPoints)
     }
 }
 
+// Images of Deboggler::Process, sized on the first frame and reused on the next ones.
+// Each image is a view on the top left corner of a storage that only grows, so frames of the same size don't
+// allocate these images again: allocations counts the times a storage had to grow. It doesn't see what OpenCV
+// allocates inside its functions nor the contour vectors, "deboggler allocations" counts all of them on the desktop.
+struct DebogglerWorkspace {
+    struct Image {
+        cv::Mat storage;
+        cv::Mat view;
+    };
+
+    size_t allocations = 0;
+
+    Image detection, detectionMask, boardMask, gated, edges, canny, masked, warped, diceMask;
+    Image character, square, characterSquare, cell, letter, montage;
+    Image inputs, samples, scores;
+    // the outputs of the layers of the neural network, and their views
+    std::vector<Image> layers;
+    std::vector<cv::Mat> layerViews;
+    std::vector<cv::Point> points, hull;
+
+    // view of the given size and type on the storage of image, the storage grows when it is too small
+    cv::Mat &fit(Image &image, const cv::Size &size, int type) {
+        auto &storage = image.storage;
+        if (storage.type() != type || storage.cols < size.width || storage.rows < size.height) {
+            storage.create(std::max(size.height, storage.rows), std::max(size.width, storage.cols), type);
+            allocations++;
+        }
+        image.view = storage(cv::Rect(0, 0, size.width, size.height));
+        return image.view;
+    }
+};
+
+// All the state of the pipeline, scratch images included, belongs to the instance: several Deboggler can process
+// frames concurrently, one thread at a time for each (see DebogglerPool).
 struct Deboggler {
     static inline const auto characterBackground = cv::Scalar(0);
     static inline constexpr int characterSize = 28;
+    // sampleCharacter samples the character at this multiple of characterSize, then area filters it down
+    static inline constexpr int characterSupersampling = 4;
+    // the dices smaller than this part of the warped board are noise: 300 pixels on the boards of images/, which
+    // are about 640 pixels wide once warped
+    static inline constexpr double minimumDiceAreaRatio = 300.0 / (640.0 * 640.0);
 
     int low_s = 255 - 125;
     int high_h = 25 + 125;
     int canny_threshold = 180;
-    
+    // the board frame is searched on the focus rect downscaled by this factor (1 = full resolution),
+    // only the perspective warp and what follows use the full resolution frame
+    int detectionScale = 1;
+    // isolate the dices with the fused kernel of Segmentation.h, the reference path is kept for comparison
+    bool fusedSegmentation = true;
+    // sample each character straight from the source frame (see sampleCharacter) instead of cutting it out of the
+    // segmented warped board, straightening, padding and resizing it. The warped board is then only used to find the
+    // letters, so the focus rect isn't masked with the board before the warp. Both read the same number of boards of
+    // images/ correctly, compare them with "deboggler sampling"
+    bool directSampling = true;
+    // side of the warped board, so what follows the warp costs the same whatever the distance to the board:
+    // 4 characters per die (0 = the size measured between the corners)
+    int canonicalBoardSize = 16 * characterSize;
+    // recognize the letters with classifier (loaded from neuralNetwork) instead of the cv::Mat path of NeuralNetwork
+    bool fixedClassifier = true;
+    // with fixedClassifier, recognize the letters with the int8 quantizedClassifier when it is loaded (only the desktop
+    // loads neuralNetwork.q8, written by quantizer)
+    bool quantizedClassifierEnabled = false;
+
     ProcessResult maxStep = ProcessResult::PROCESS_SUCCESS;
 #ifdef WRITE_IMAGE
     std::string imageName;
 #endif
 
     std::vector<std::vector<cv::Point>> contours;
+    std::vector<std::vector<cv::Point>> diceContours;
     std::vector<std::vector<cv::Point>> hulls{1};
     std::vector<cv::Point> simplifiedHull;
     std::vector<cv::RotatedRect> diceRotatedRects;
     cv::Point2f orderedPoints[4];
     cv::Point2f straightPoints[4];
+    // Otsu's threshold of the last segmentation, the one of the warped board once it is segmented
+    int boardThreshold = 0;
 
-    cv::Mat characterMat;
+    DebogglerWorkspace workspace;
+    cv::Mat *lastMask = nullptr;
     cv::Mat warpedMat;
     uint16_t *guessedBoard;
 
     NeuralNetwork neuralNetwork;
+    LetterClassifier classifier;
+    QuantizedLetterClassifier quantizedClassifier;
 
     void (*logCallback)(const char *);
 
+    // mask receives a view of the last mask computed (the one of the step reached when maxStep is set)
     ProcessResult Process(cv::Mat &src, cv::Mat &mask) {
-        contours.clear();
+        auto result = processFrame(src);
+        if (lastMask != nullptr)
+            mask = *lastMask;
+        return result;
+    }
 
+    ProcessResult processFrame(cv::Mat &src) {
         auto roi = computeFocusRect(src);
-        isolateBoggleDice(src, mask, canny_threshold, &roi);
+        auto detectionRoi = roi;
+        auto &boardMask = workspace.fit(workspace.boardMask, roi.size(), CV_8UC1);
+        auto *detectionMask = &boardMask;
+        if (detectionScale > 1) {
+            auto &detection = workspace.fit(workspace.detection, cv::Size(roi.width / detectionScale, roi.height / detectionScale), src.type());
+            cv::resize(src(roi), detection, detection.size(), 0, 0, cv::INTER_AREA);
+            detectionRoi = cv::Rect(0, 0, detection.cols, detection.rows);
+            detectionMask = &workspace.fit(workspace.detectionMask, detection.size(), CV_8UC1);
+            isolateBoggleDice(detection, *detectionMask, canny_threshold);
+        } else {
+            isolateBoggleDice(src, *detectionMask, canny_threshold, &roi);
+        }
+        auto &mask = *detectionMask;
+        lastMask = &mask;
         cv::floodFill(mask, cv::Point(0, 0), 0);
         cv::floodFill(mask, cv::Point(mask.size().width - 1, 0), 0);
         cv::floodFill(mask, cv::Point(mask.size().width - 1, mask.size().height - 1), 0);
         cv::floodFill(mask, cv::Point(0, mask.size().height - 1), 0);
         CHECK_MAX_STEP(ProcessResult::BoardIsolated, maxStep);
 
-        int diceCount = findDicesContours(mask, roi, contours, simplifiedHull);
+        int diceCount = findDicesContours(mask, detectionRoi, contours, simplifiedHull);
         if (diceCount < 16)
             return ProcessResult::DicesNotFound;
         CHECK_MAX_STEP(ProcessResult::DicesFound, maxStep);
 
 
-        if (!mergeBlobs(mask, contours))
+        if (!mergeBlobs(mask, contours, std::min(diceCount, 16), workspace.points, workspace.hull, detectionScale))
             return ProcessResult::BlobsNotMerged;
         CHECK_MAX_STEP(ProcessResult::BlobsMerged, maxStep);
 
-        if (!findFrameFromContours(0, contours, hulls, simplifiedHull))
+        if (!findFrameFromContours(0, contours, hulls, simplifiedHull, workspace.hull))
             return ProcessResult::FrameNotFound;
+        if (detectionScale > 1) {
+            upscaleFrame(detectionScale, mask, boardMask, hulls, simplifiedHull);
+            lastMask = &boardMask;
+        }
 
-        CHECK_MAX_STEP(ProcessResult::FrameFound, maxStep, drawFrameAndCorners(src, mask, roi, hulls, simplifiedHull));
+        CHECK_MAX_STEP(ProcessResult::FrameFound, maxStep, drawFrameAndCorners(src, boardMask, roi, hulls, simplifiedHull));
 
-        auto frameSize = orderAndSetCorners(simplifiedHull, orderedPoints, straightPoints);
-        CHECK_MAX_STEP(ProcessResult::CornersFound, maxStep, drawCorners(src, mask, orderedPoints));
+        auto frameSize = orderAndSetCorners(simplifiedHull, orderedPoints, straightPoints, canonicalBoardSize);
+        CHECK_MAX_STEP(ProcessResult::CornersFound, maxStep, drawCorners(src, boardMask, orderedPoints));
 
-        auto transform = cv::getPerspectiveTransform(orderedPoints, straightPoints);
-        src(roi).copyTo(warpedMat, mask);
-        cv::warpPerspective(warpedMat, warpedMat, transform, frameSize);
+        auto transform = perspectiveTransform(orderedPoints, straightPoints);
+        warpedMat = workspace.fit(workspace.warped, frameSize, src.type());
+        if (directSampling) {
+            cv::warpPerspective(src(roi), warpedMat, transform, frameSize);
+        } else {
+            auto &masked = workspace.fit(workspace.masked, roi.size(), src.type());
+            masked = cv::Scalar::all(0);
+            src(roi).copyTo(masked, boardMask);
+            cv::warpPerspective(masked, warpedMat, transform, frameSize);
+        }
         CHECK_MAX_STEP(ProcessResult::Warped, maxStep);
 
-        isolateBoggleDice(warpedMat, mask, 255);
+        auto &diceMask = workspace.fit(workspace.diceMask, frameSize, CV_8UC1);
+        isolateBoggleDice(warpedMat, diceMask, 255);
+        lastMask = &diceMask;
         CHECK_MAX_STEP(ProcessResult::WarpedAndIsolated, maxStep);
 
-        cleanIsolatedDices(mask);
+        cleanIsolatedDices(diceMask);
         CHECK_MAX_STEP(ProcessResult::WarpedAndIsolatedAndCleaned, maxStep);
 
-        findOrderedIndivididualDicesContours(mask, contours, diceRotatedRects);
+        findOrderedIndivididualDicesContours(diceMask, diceContours, diceRotatedRects, minimumDiceAreaRatio * frameSize.area());
         if (diceRotatedRects.size() < 16)
             return ProcessResult::IndividualDicesNotFound;
         CHECK_MAX_STEP(ProcessResult::IndividualDicesFound, maxStep);
 
-        mergeRelatedContours(mask, diceRotatedRects);
+        mergeRelatedContours(diceMask, diceRotatedRects);
         CHECK_MAX_STEP(ProcessResult::IndividualDicesFoundAndMerged, maxStep);
         if (diceRotatedRects.size() != 16)
             return ProcessResult::IndividualDicesNotFound;
 
 #ifdef WRITE_IMAGE
-        drawLinedUpSortedRects(mask, warpedMat, diceRotatedRects);
-#endif
-
-#ifdef WRITE_IMAGE
-        auto folder = std::filesystem::path("../output/");
+        static const auto folder = std::filesystem::path("../output/");
         if (!imageName.empty()) {
             if (!std::filesystem::is_directory(folder) || !std::filesystem::exists(folder)) { // Check if src folder exists
                 std::filesystem::create_directory(folder); // create src folder
@@ -167,38 +251,93 @@ struct Deboggler {
         }
 #endif
 #ifdef WRITE_IMAGE
-        warpedMat = cv::Mat(cv::Size(characterSize * 4, characterSize * 4), CV_8UC1, characterBackground);
+        warpedMat = workspace.fit(workspace.montage, cv::Size(characterSize * 4, characterSize * 4), CV_8UC1);
+        warpedMat.setTo(characterBackground);
         cv::Rect dstRoi(0, 0, characterSize, characterSize);
 #endif
+        // the 16 dices are recognized at once: the characters are the rows of samples for the classifier, the columns
+        // of inputs for the neural network
         float averageScore = 0;
-        for (int i = 0; i < diceRotatedRects.size() && i < 16; ++i) {
-            extractAndStraighten(mask, characterMat, diceRotatedRects[i]);
-            resizeAndFitACenter(characterMat, cv::Size(characterSize, characterSize), characterBackground);
+        int letterCount = std::min(int(diceRotatedRects.size()), 16);
+        bool useClassifier = fixedClassifier && classifier.isLoaded();
+        auto &characterMat = workspace.fit(workspace.characterSquare, cv::Size(characterSize, characterSize), CV_8UC1);
+        auto &inputs = useClassifier
+                       ? workspace.fit(workspace.samples, cv::Size(characterSize * characterSize, letterCount), CV_32FC1)
+                       : workspace.fit(workspace.inputs, cv::Size(letterCount, characterSize * characterSize), CV_32FC1);
+        cv::Matx33d warpedToSource;
+        if (directSampling)
+            warpedToSource = cv::Matx33d(1, 0, roi.x, 0, 1, roi.y, 0, 0, 1) * perspectiveTransform(straightPoints, orderedPoints);
+        for (int i = 0; i < letterCount; ++i) {
+            if (directSampling) {
+                sampleCharacter(src, warpedToSource, diceRotatedRects[i], characterMat);
+            } else {
+                auto &straightened = extractAndStraighten(diceMask, diceRotatedRects[i]);
+                resizeAndFitACenter(straightened, characterMat, characterBackground);
+            }
 
 #ifdef WRITE_IMAGE
             writeCharacterToFile(characterMat, warpedMat, &dstRoi, i, imageName, folder, false);
 #endif
+            if (useClassifier)
+                setInputRow(characterMat, inputs, i);
+            else
+                setInputColumn(characterMat, inputs, i);
+        }
+
 #ifdef FEEDFORWARD
-            characterMat = characterMat.reshape(1, characterMat.cols * characterMat.rows);
-            characterMat.convertTo(characterMat, CV_32FC1, 1.0f / 255.0f);
-            auto guess = neuralNetwork.feed_forward(characterMat);
-            int maxIndex = 0;
-            for (int k = 1; k < 26; ++k) {
-                if (guess.at<float>(0, k) > guess.at<float>(0, maxIndex)) {
-                    maxIndex = k;
-                }
-            }
-            char guessedChar = (char) ('A' + maxIndex);
-            averageScore += guess.at<float>(0, maxIndex);
-//            log("%c (%f)\n", guessedChar, guess.at<float>(0, maxIndex));
+        int maxIndices[16];
+        float scores[16];
+        if (useClassifier) {
+            auto &guesses = workspace.fit(workspace.scores, cv::Size(26, letterCount), CV_32FC1);
+            if (quantizedClassifierEnabled && quantizedClassifier.isLoaded())
+                quantizedClassifier.feed_forward(inputs.ptr<float>(0), letterCount, guesses.ptr<float>(0));
+            else
+                classifier.feed_forward(inputs.ptr<float>(0), letterCount, guesses.ptr<float>(0));
+            LetterClassifier::argmax(guesses.ptr<float>(0), letterCount, maxIndices, scores);
+        } else {
+            auto &layers = workspace.layerViews;
+            workspace.layers.resize(std::max(workspace.layers.size(), neuralNetwork.m_weights.size()));
+            layers.resize(neuralNetwork.m_weights.size());
+            for (size_t l = 0; l < layers.size(); ++l)
+                layers[l] = workspace.fit(workspace.layers[l], cv::Size(letterCount, neuralNetwork.m_weights[l].rows), CV_32FC1);
+            neuralNetwork.feed_forward(inputs, layers);
+            NeuralNetwork::argmax_columns(layers.back(), maxIndices, scores);
+        }
+        for (int i = 0; i < letterCount; ++i) {
+            char guessedChar = (char) ('A' + maxIndices[i]);
+            averageScore += scores[i];
+//            log("%c (%f)\n", guessedChar, scores[i]);
             guessedBoard[i] = guessedChar;
-#endif
         }
+#endif
 
         averageScore /= 16.0f;
         return averageScore > 0.97f ? ProcessResult::PROCESS_SUCCESS : ProcessResult::PROCESS_SUCCESS_INDECISIVE;
     }
 
+    // write the pixels of character, scaled to [0, 1], in the given column of inputs
+    static void setInputColumn(const cv::Mat &character, cv::Mat &inputs, int column) {
+        auto step = inputs.step1();
+        auto *input = inputs.ptr<float>(0) + column;
+        for (int y = 0; y < character.rows; ++y) {
+            const uchar *pixels = character.ptr<uchar>(y);
+            for (int x = 0; x < character.cols; ++x, input += step) {
+                *input = pixels[x] * (1.0f / 255.0f);
+            }
+        }
+    }
+
+    // write the pixels of character, scaled to [0, 1], in the given row of inputs
+    static void setInputRow(const cv::Mat &character, cv::Mat &inputs, int row) {
+        auto *input = inputs.ptr<float>(row);
+        for (int y = 0; y < character.rows; ++y) {
+            const uchar *pixels = character.ptr<uchar>(y);
+            for (int x = 0; x < character.cols; ++x) {
+                *input++ = pixels[x] * (1.0f / 255.0f);
+            }
+        }
+    }
+
     // compute the focus rect (square area at the center of the image)
     static cv::Rect computeFocusRect(const cv::Mat& src) {
         int size = 0, x = 0, y = 0;
@@ -216,7 +355,14 @@ struct Deboggler {
     // Method: - use inRange with the color of the board to produce a mask of the boggle board
     //         - use canny to detect edges and dilate them to produce a mask with distinct borders
     //         - use Otsu's binarization coupled with the two previous masks to keep only the dices
-    void isolateBoggleDice(cv::Mat& src, cv::Mat &mask, int cannyThreshold1, cv::Rect *roi = nullptr) const {
+    void isolateBoggleDice(cv::Mat& src, cv::Mat &mask, int cannyThreshold1, cv::Rect *roi = nullptr) {
+        if (fusedSegmentation) {
+            auto size = roi != nullptr ? roi->size() : src.size();
+            boardThreshold = segmentBoggleDice(roi != nullptr ? src(*roi) : src, mask, low_s, high_h, cannyThreshold1,
+                                               workspace.fit(workspace.gated, size, CV_8UC3), workspace.fit(workspace.edges, size, CV_8UC1));
+            return;
+        }
+
         cv::cvtColor(src, mask, cv::COLOR_BGR2HSV);
         cv::Vec3b lower(0, low_s, 0);
         cv::Vec3b upper(high_h, 255, 255);
@@ -226,7 +372,7 @@ struct Deboggler {
         if (roi != nullptr)
             mask = mask(*roi);
 
-        static cv::Mat canny;
+        auto &canny = workspace.fit(workspace.canny, mask.size(), CV_8UC1);
         if (cannyThreshold1 < 255) {
             cv::Canny(mask, canny, cannyThreshold1, 255);
             auto element = getStructuringElement(0, cv::Size(3, 3));
@@ -235,7 +381,7 @@ struct Deboggler {
         }
 
         cv::cvtColor(mask, mask, cv::COLOR_BGR2GRAY);
-        cv::threshold(mask, mask, 127, 255, cv::THRESH_BINARY | cv::THRESH_OTSU);
+        boardThreshold = int(cv::threshold(mask, mask, 127, 255, cv::THRESH_BINARY | cv::THRESH_OTSU));
         if (cannyThreshold1 < 255) {
             cv::bitwise_and(mask, canny, mask);
         }
@@ -247,6 +393,7 @@ struct Deboggler {
     //                                    - its size must be bigger than an eigth of the image 
     //                                    - its aspect ratio must be close to 1 (it's squarish) 
     //                                    - its solidity must be close to 1 (solidity is the ratio of contour area to its convex hull area)
+    // the first 16 dices found are drawn in the mask and moved to the front of contours, return the number of dices found
     static int findDicesContours(cv::Mat &mask, cv::Rect &roi,
                                  std::vector<std::vector<cv::Point>> &contours,
                                  std::vector<cv::Point> &hull) {
@@ -266,47 +413,150 @@ struct Deboggler {
             auto solidity = (cv::contourArea(contours[i]) / cv::contourArea(hull));
             isInvalid = isInvalid || std::abs(1.0f - solidity) > 0.4f;
             if (!isInvalid) {
-                drawContours(mask, contours, (int) i, count++ < 16 ? 255 : 0, -1);
+                if (count < 16) {
+                    drawContours(mask, contours, (int) i, 255, -1);
+                    std::swap(contours[count], contours[i]);
+                }
+                count++;
             }
         }
         return count;
     }
 
-    // Dilate the given image until there is only one blob
-    static bool mergeBlobs(cv::Mat &mask, std::vector<std::vector<cv::Point>> &contours) {
-        int size = 0;
+    // Merge the dice blobs into one board region, written into contours[0] and filled in the mask.
+    // Method: - dilating the blobs with a square kernel of radius r joins two of them when the gap between them is
+    //           at most 2r: the gaps between their bounding boxes are sorted and the blobs are clustered with a
+    //           union-find until there is only one cluster left, the last gap merged gives the radius needed
+    //         - the radius is rounded up on the steps of the dilation (10, 20, 30... pixels at full resolution, cumulated)
+    //         - the region is the convex hull of the blobs grown by that radius, the same hull as the dilated mask
+    // Only the first count (at most 16) contours are merged, points and hull are working vectors.
+    static bool mergeBlobs(cv::Mat &mask, std::vector<std::vector<cv::Point>> &contours, int count,
+                           std::vector<cv::Point> &points, std::vector<cv::Point> &hull, int scale = 1) {
+        constexpr int maxCount = 16;
+        count = std::min(count, maxCount);
+        if (count == 0)
+            return false;
+
+        struct Gap {
+            int distance;
+            int first, second;
+        };
+        cv::Rect boxes[maxCount];
+        Gap gaps[maxCount * (maxCount - 1) / 2];
+        int gapCount = 0;
+        for (int i = 0; i < count; ++i) {
+            boxes[i] = cv::boundingRect(contours[i]);
+            for (int j = 0; j < i; ++j) {
+                auto &a = boxes[i], &b = boxes[j];
+                int dx = std::max(a.x, b.x) - std::min(a.x + a.width, b.x + b.width);
+                int dy = std::max(a.y, b.y) - std::min(a.y + a.height, b.y + b.height);
+                gaps[gapCount++] = {std::max(0, std::max(dx, dy)), i, j};
+            }
+        }
+        std::sort(gaps, gaps + gapCount, [](const Gap &a, const Gap &b) { return a.distance < b.distance; });
+
+        int parents[maxCount];
+        for (int i = 0; i < count; ++i) {
+            parents[i] = i;
+        }
+        auto find = [&parents](int i) {
+            while (parents[i] != i) {
+                i = parents[i] = parents[parents[i]];
+            }
+            return i;
+        };
+        int clusters = count;
+        int largestGap = 0;
+        for (int i = 0; i < gapCount && clusters > 1; ++i) {
+            int first = find(gaps[i].first), second = find(gaps[i].second);
+            if (first != second) {
+                parents[first] = second;
+                largestGap = gaps[i].distance;
+                clusters--;
+            }
+        }
+
+        int size = 0, radius = 0;
         do {
             size += 10;
-            auto element = getStructuringElement(0, cv::Size(2 * size + 1, 2 * size + 1), cv::Point(size, size));
-            dilate(mask, mask, element);
-            findContours(mask, contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
-        } while (contours.size() > 1 && size < 255);
+            radius += std::max(1, size / scale);
+        } while (2 * radius < largestGap && size < 255);
+        if (2 * radius < largestGap)
+            return false;
+
+        points.clear();
+        for (int i = 0; i < count; ++i) {
+            points.insert(points.end(), contours[i].begin(), contours[i].end());
+        }
+        cv::convexHull(points, hull);
+        points.clear();
+        for (const auto &point: hull) {
+            int left = std::max(point.x - radius, 0), right = std::min(point.x + radius, mask.cols - 1);
+            int top = std::max(point.y - radius, 0), bottom = std::min(point.y + radius, mask.rows - 1);
+            points.emplace_back(left, top);
+            points.emplace_back(right, top);
+            points.emplace_back(right, bottom);
+            points.emplace_back(left, bottom);
+        }
+        cv::convexHull(points, contours[0]);
 
-        return contours.size() == 1;
+        mask = 0;
+        cv::fillConvexPoly(mask, contours[0], 255);
+        return true;
     }
 
     // Given a particular contour, try and simplify it to a 4-point hull
     static bool findFrameFromContours(int index, const std::vector<std::vector<cv::Point>> &contours,
-                                      std::vector<std::vector<cv::Point>> &hulls, std::vector<cv::Point> &simplifiedHull) {
+                                      std::vector<std::vector<cv::Point>> &hulls, std::vector<cv::Point> &simplifiedHull,
+                                      std::vector<cv::Point> &candidate) {
         convexHull(contours[index], hulls[index]);
-        auto peri = cv::arcLength(hulls[index], true);
-
-        double epsilon = 0.11;
-        do {
-            epsilon += 0.01;
-            cv::approxPolyDP(hulls[index], simplifiedHull, epsilon * 0.1 * peri, true);
-        } while (simplifiedHull.size() > 4 && epsilon < 10.0);
+        fitQuadrilateral(hulls[index], simplifiedHull, candidate);
         hulls[index] = simplifiedHull;
         return simplifiedHull.size() == 4;
     }
 
+    // map the frame found on the downscaled focus rect back to the full resolution one:
+    // the points are moved to the center of the pixels they come from and the mask is resized into boardMask.
+    // The dices are segmented again on the warped image, a corner precision of a few pixels is enough.
+    static void upscaleFrame(int scale, const cv::Mat &mask, cv::Mat &boardMask,
+                             std::vector<std::vector<cv::Point>> &hulls, std::vector<cv::Point> &simplifiedHull) {
+        auto offset = cv::Point(scale / 2, scale / 2);
+        for (auto &point: simplifiedHull) {
+            point = point * scale + offset;
+        }
+        hulls[0] = simplifiedHull;
+        cv::resize(mask, boardMask, boardMask.size(), 0, 0, cv::INTER_NEAREST);
+    }
+
+    // same as cv::getPerspectiveTransform, without allocating the result
+    static cv::Matx33d perspectiveTransform(const cv::Point2f *src, const cv::Point2f *dst) {
+        cv::Matx<double, 8, 8> a;
+        cv::Matx<double, 8, 1> b;
+        for (int i = 0; i < 4; ++i) {
+            a(i, 0) = a(i + 4, 3) = src[i].x;
+            a(i, 1) = a(i + 4, 4) = src[i].y;
+            a(i, 2) = a(i + 4, 5) = 1;
+            a(i, 3) = a(i, 4) = a(i, 5) = a(i + 4, 0) = a(i + 4, 1) = a(i + 4, 2) = 0;
+            a(i, 6) = -src[i].x * dst[i].x;
+            a(i, 7) = -src[i].y * dst[i].x;
+            a(i + 4, 6) = -src[i].x * dst[i].y;
+            a(i + 4, 7) = -src[i].y * dst[i].y;
+            b(i) = dst[i].x;
+            b(i + 4) = dst[i].y;
+        }
+        auto x = a.solve(b, cv::DECOMP_LU);
+        return {x(0), x(1), x(2), x(3), x(4), x(5), x(6), x(7), 1.0};
+    }
+
     // given 4 points, order them in the (topLeft, topRight, bottomRight, bottomLeft) order
     // orderedPoints contains the given points in the order mentionned above 
     // straightPoints contains the matching points on a square in the order mentionned above (used for warp transform) 
-    // return the maximum size of the englobing rect
+    // order the corners of the board and set the corners of the warped board: a canonicalSize square, or the
+    // largest width and height between the corners when canonicalSize is 0
     static cv::Size orderAndSetCorners(const std::vector<cv::Point> &points,
                                        cv::Point2f *orderedPoints,
-                                       cv::Point2f *straightPoints) {
+                                       cv::Point2f *straightPoints,
+                                       int canonicalSize = 0) {
         int smallestSum = std::numeric_limits<int>::max(), largestSum = std::numeric_limits<int>::min();
         int smallestDiff = std::numeric_limits<int>::max(), largestDiff = std::numeric_limits<int>::min();
         for (int i = 0; i < points.size(); ++i) {
@@ -332,6 +582,8 @@ struct Deboggler {
 
         int width = std::max(orderedPoints[1].x - orderedPoints[0].x, orderedPoints[2].x - orderedPoints[3].x); // topWidth - bottomWidth
         int height = std::max(orderedPoints[3].y - orderedPoints[0].y, orderedPoints[2].y - orderedPoints[1].y); // leftHeight - rightHeight
+        if (canonicalSize > 0)
+            width = height = canonicalSize;
 
         straightPoints[0] = cv::Point(0, 0);
         straightPoints[1] = cv::Point(width, 0);
@@ -357,13 +609,14 @@ struct Deboggler {
     //         - then for each line we sort them horizontally 
     static void findOrderedIndivididualDicesContours(cv::Mat &mask,
                                                      std::vector<std::vector<cv::Point>> &contours,
-                                                     std::vector<RotatedRect> &diceRotatedRects) {
+                                                     std::vector<RotatedRect> &diceRotatedRects,
+                                                     double minimumArea) {
         diceRotatedRects.clear();
         findContours(mask, contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
         for (int i = 0; i < contours.size(); ++i) {
             auto rect = minAreaRect(contours[i]);
             bool isInvalid = false;
-            isInvalid = isInvalid || rect.size.area() < 300;
+            isInvalid = isInvalid || rect.size.area() < minimumArea;
             isInvalid = isInvalid || rect.size.aspectRatio() > 6;
             if (!isInvalid) {
                 diceRotatedRects.push_back(rect);
@@ -397,7 +650,7 @@ struct Deboggler {
     //          - if it is, we merge the two into i and mark (i+1) to be removed
     //          - remove all marked rects 
     static void mergeRelatedContours(cv::Mat &mask, std::vector<RotatedRect> &diceRotatedRects) {
-        std::vector<int> indicesToRemove;
+        size_t kept = 0;
         auto lineHalfHeight = mask.rows / 8.0f;
         auto columnHalfWidth = mask.cols / 8.0f;
         for (int i = 0; i < diceRotatedRects.size(); ++i) {
@@ -414,19 +667,14 @@ struct Deboggler {
                               && (diceRotatedRects[i + 1].center.y - diceRotatedRects[i].center.y) < lineHalfHeight;
                 if (shouldMerge) {
                     diceRotatedRects[i] = mergeRotatedRect(diceRotatedRects[i + 1], diceRotatedRects[i]);
-                    indicesToRemove.push_back(i + 1);
+                    diceRotatedRects[kept++] = diceRotatedRects[i];
                     i++;
+                    continue;
                 }
             }
+            diceRotatedRects[kept++] = diceRotatedRects[i];
         }
-
-        if (!indicesToRemove.empty()) {
-            for (int i = int(indicesToRemove.size()) - 1; i >= 0; --i) {
-                auto it = diceRotatedRects.begin();
-                std::advance(it, indicesToRemove[i]);
-                diceRotatedRects.erase(it);
-            }
-        }
+        diceRotatedRects.resize(kept);
     }
 
     static void writeCharacterToFile(cv::Mat &src, cv::Mat &dst, cv::Rect *dstRoi, int index,
@@ -461,41 +709,52 @@ struct Deboggler {
         }
     }
 
-    static void drawLinedUpSortedRects(cv::Mat &mask, cv::Mat &dst, const std::vector<RotatedRect> &rects) {
-        int totalWidth = 0;
-        int maximumHeight = 0;
-        for (int i = 0; i < rects.size(); ++i) {
-            auto &rect = rects[i];
-            totalWidth += rect.boundingRect().size().width;
-            if (maximumHeight < rect.boundingRect().size().height)
-                maximumHeight = rect.boundingRect().size().height;
-        }
-
-        int xDstOffset = 0;
-        dst = cv::Mat::zeros(maximumHeight, totalWidth, CV_8UC1);
-        for (int i = 0; i < rects.size(); ++i) {
-            Rect rect = rects[i].boundingRect();
-            validateROIFor(rect, mask);
-            auto dstRoi = cv::Rect(xDstOffset, 0, rect.size().width, rect.size().height);
-            mask(rect).copyTo(dst(dstRoi));
-            xDstOffset += rect.size().width;
-        }
+    // center src on a square of the background color and resize it into dst, the square is kept in the workspace
+    void resizeAndFitACenter(const cv::Mat &src, cv::Mat &dst, const cv::Scalar &background) {
+        int side = std::max(src.cols, src.rows);
+        auto &square = workspace.fit(workspace.square, cv::Size(side, side), src.type());
+        square = background;
+        src.copyTo(square(cv::Rect((side - src.cols) / 2, (side - src.rows) / 2, src.cols, src.rows)));
+        cv::resize(square, dst, dst.size(), 0, 0, cv::INTER_AREA);
     }
 
-    static void resizeAndFitACenter(cv::Mat &src, const cv::Size &size, const cv::Scalar &background) {
-        if (src.cols > src.rows) {
-            cv::Mat resize = cv::Mat(src.cols, src.cols, src.type(), background);
-            src.copyTo(resize(cv::Rect(0, (src.cols - src.rows) / 2, src.cols, src.rows)));
-            src = resize;
-        } else {
-            cv::Mat resize = cv::Mat(src.rows, src.rows, src.type(), background);
-            src.copyTo(resize(cv::Rect((src.rows - src.cols) / 2, 0, src.cols, src.rows)));
-            src = resize;
+    // Character of a die sampled from the source frame, without the warped board nor the straightened die.
+    // Method: - the cell of the character (the die centered in a square, as resizeAndFitACenter does) is mapped to the
+    //           warped board by the rotation and scale of the die, then to the source by the inverse board homography:
+    //           one warpPerspective composes both and samples the source once
+    //         - die is the rect of a letter found in the cleaned dice mask, where cleanIsolatedDices made the letter
+    //           white on black: inside the rect, what is not the die face (board color, or grayscale not above the board
+    //           threshold) is the letter, the die face and what is outside the rect are the background
+    //         - the cell is sampled and binarized at characterSupersampling times the size of dst, then resized into dst
+    //           with INTER_AREA: the edges of the letter are gray, as the ones of resizeAndFitACenter
+    void sampleCharacter(const cv::Mat &src, const cv::Matx33d &warpedToSource, const cv::RotatedRect &die, cv::Mat &dst) {
+        cv::Size size(dst.cols * characterSupersampling, dst.rows * characterSupersampling);
+        double side = std::max(die.size.width, die.size.height);
+        double scale = side / size.width, offset = 0.5 * scale - 0.5 * side;
+        double radians = die.angle * CV_PI / 180.0, alpha = std::cos(radians), beta = std::sin(radians);
+        cv::Matx33d cellToWarped(alpha * scale, -beta * scale, die.center.x + (alpha - beta) * offset,
+                                 beta * scale, alpha * scale, die.center.y + (beta + alpha) * offset,
+                                 0, 0, 1);
+        auto &cell = workspace.fit(workspace.cell, size, src.type());
+        auto &letter = workspace.fit(workspace.letter, size, CV_8UC1);
+        cv::warpPerspective(src, cell, warpedToSource * cellToWarped, cell.size(), cv::INTER_LINEAR | cv::WARP_INVERSE_MAP);
+
+        double halfWidth = 0.5 * die.size.width, halfHeight = 0.5 * die.size.height;
+        for (int v = 0; v < cell.rows; ++v) {
+            const uchar *in = cell.ptr<uchar>(v);
+            uchar *out = letter.ptr<uchar>(v);
+            bool insideRow = std::abs((v + 0.5) * scale - 0.5 * side) <= halfHeight;
+            for (int u = 0; u < cell.cols; ++u, in += 3) {
+                bool inside = insideRow && std::abs((u + 0.5) * scale - 0.5 * side) <= halfWidth;
+                bool isFace = !isBoardColor(in[0], in[1], in[2], low_s, high_h) && grayOf(in[0], in[1], in[2]) > boardThreshold;
+                out[u] = inside && !isFace ? 255 : uchar(characterBackground[0]);
+            }
         }
-        cv::resize(src, src, size, cv::INTER_AREA);
+        cv::resize(letter, dst, dst.size(), 0, 0, cv::INTER_AREA);
     }
 
-    static void extractAndStraighten(cv::Mat &src, cv::Mat &dest, const cv::RotatedRect &patchROI) {
+    // upright copy of the patch of src, in a view of the workspace
+    cv::Mat &extractAndStraighten(const cv::Mat &src, const cv::RotatedRect &patchROI) {
 
         // obtain the bounding box of the desired patch
         cv::Rect boundingRect = patchROI.boundingRect();
@@ -513,14 +772,17 @@ struct Deboggler {
         cropMidY = boundingRect.height / 2;
 
         // obtain the affine transform that maps the patch ROI in the image to the
-        // dest patch image. The dest image will be an upright version.
-        auto map_mat = cv::getRotationMatrix2D(cv::Point2f(cropMidX, cropMidY), angle, 1.0f);
-        map_mat.at<double>(0, 2) += static_cast<double>(width / 2 - cropMidX);
-        map_mat.at<double>(1, 2) += static_cast<double>(height / 2 - cropMidY);
-
-        // rotate the pre-cropped image. The destination image will be
-        // allocated by warpAffine()
-        cv::warpAffine(preCropImg, dest, map_mat, cv::Size2i(width, height));
+        // dest patch image (cv::getRotationMatrix2D, without allocating). The dest image will be an upright version.
+        double radians = angle * CV_PI / 180.0, alpha = std::cos(radians), beta = std::sin(radians);
+        cv::Matx23d map_mat(alpha, beta, (1 - alpha) * cropMidX - beta * cropMidY,
+                            -beta, alpha, beta * cropMidX + (1 - alpha) * cropMidY);
+        map_mat(0, 2) += static_cast<double>(width / 2 - cropMidX);
+        map_mat(1, 2) += static_cast<double>(height / 2 - cropMidY);
+
+        // rotate the pre-cropped image into the workspace
+        auto &dest = workspace.fit(workspace.character, cv::Size2i(width, height), src.type());
+        cv::warpAffine(preCropImg, dest, map_mat, dest.size());
+        return dest;
     }
 
     static void addSaltAndPepper(cv::Mat &dst, float pa = 0.05, float pb = 0.05) {
@@ -540,8 +802,8 @@ struct Deboggler {
         int ret;
         va_list myargs;
         va_start(myargs, fmt);
-        static char buffer[4096];
-        ret = vsprintf(buffer, fmt, myargs);
+        char buffer[4096];
+        ret = vsnprintf(buffer, sizeof(buffer), fmt, myargs);
         va_end(myargs);
         if (logCallback != nullptr) {
             logCallback(buffer);
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cmath>
+#include <vector>
+#include <opencv2/imgproc.hpp>
+
+// Simplify a convex hull into a quadrilateral with approxPolyDP, looking for the smallest epsilon that gives at most 4 points.
+// epsilon is expressed in tenths of the perimeter of the hull and searched by bisection in [minimumEpsilon, maximumEpsilon]
+// up to the given precision, so the number of approxPolyDP calls is bounded whatever the hull, then snapped to the first
+// step of a linear sweep (minimumEpsilon + k * precision) in the bracket found.
+// This is an approximation of the sweep: Douglas-Peucker doesn't guarantee that the number of points decreases with
+// epsilon, so a smaller epsilon outside the bracket may also give at most 4 points.
+// The result may have less than 4 points when the hull can't be reduced to exactly 4. Return the epsilon used.
+// candidate is a working vector, kept by the caller to avoid allocating on each call.
+static double fitQuadrilateral(const std::vector<cv::Point> &hull, std::vector<cv::Point> &quadrilateral,
+                               std::vector<cv::Point> &candidate,
+                               double minimumEpsilon = 0.12, double maximumEpsilon = 10.0, double precision = 0.01) {
+    auto peri = cv::arcLength(hull, true);
+    cv::approxPolyDP(hull, quadrilateral, minimumEpsilon * 0.1 * peri, true);
+    if (quadrilateral.size() <= 4)
+        return minimumEpsilon;
+
+    // invariant: more than 4 points at low, at most 4 at high
+    double low = minimumEpsilon, high = maximumEpsilon;
+    cv::approxPolyDP(hull, quadrilateral, high * 0.1 * peri, true);
+    if (quadrilateral.size() > 4)
+        return high;
+    while (high - low > precision) {
+        double middle = 0.5 * (low + high);
+        cv::approxPolyDP(hull, candidate, middle * 0.1 * peri, true);
+        if (candidate.size() <= 4) {
+            high = middle;
+            quadrilateral.swap(candidate);
+        } else {
+            low = middle;
+        }
+    }
+
+    // the steps of the sweep in ]low, high[, at most one or two
+    for (double step = std::ceil((low - minimumEpsilon) / precision); ; ++step) {
+        double epsilon = minimumEpsilon + step * precision;
+        if (epsilon <= low)
+            continue;
+        if (epsilon >= high)
+            break;
+        cv::approxPolyDP(hull, candidate, epsilon * 0.1 * peri, true);
+        if (candidate.size() <= 4) {
+            quadrilateral.swap(candidate);
+            return epsilon;
+        }
+    }
+    return high;
+}
+
+static double fitQuadrilateral(const std::vector<cv::Point> &hull, std::vector<cv::Point> &quadrilateral) {
+    std::vector<cv::Point> candidate;
+    return fitQuadrilateral(hull, quadrilateral, candidate);
+}
@@ -0,0 +1,200 @@
+#pragma once
+
+#include <algorithm>
+#include <cfloat>
+#include <opencv2/core.hpp>
+#include <opencv2/core/hal/intrin.hpp>
+#include <opencv2/imgproc.hpp>
+
+// Fused version of the segmentation of Deboggler::isolateBoggleDice.
+// Method: - a single sweep over the BGR pixels gates the color of the board without converting to HSV, writes the
+//           gated image (needed by Canny) and its grayscale version, and accumulates the histogram of the grayscale
+//         - Otsu's threshold is computed from that histogram
+//         - a second sweep binarizes the grayscale and removes the dilated Canny edges
+// The result is the one of the reference path, up to the rounding of the lookup tables cvtColor uses for the hue
+// and the saturation (a difference of one level on a few colors at the boundary of the range).
+
+// OpenCV 8-bit HSV: V = max(B, G, R), S = 255 * (V - min) / V and H = base + 30 * num / (V - min), rounded, where the
+// base and num depend on the largest channel. The board color is H <= highHue and S >= lowSaturation, both
+// comparisons are done on integers with the rounding folded in.
+static inline bool isBoardColor(int b, int g, int r, int lowSaturation, int highHue) {
+    int v = std::max(std::max(b, g), r);
+    int diff = v - std::min(std::min(b, g), r);
+    bool saturationOk = 255 * diff + (v >> 1) >= lowSaturation * v && (v > 0 || lowSaturation == 0);
+
+    int num, base;
+    if (v == r) {
+        num = g - b;
+        base = 60 * num < -diff ? 180 : 0; // negative hues wrap around
+    } else if (v == g) {
+        num = b - r;
+        base = 60;
+    } else {
+        num = r - g;
+        base = 120;
+    }
+    // hue is within [base - 30, base + 30]: the bound can be clamped, which keeps the products on 16 bits
+    int bound = std::min(std::max(highHue - base, -31), 31);
+    bool hueOk = diff == 0 || 60 * num < (2 * bound + 1) * diff;
+    return saturationOk && hueOk;
+}
+
+static inline int grayOf(int b, int g, int r) {
+    return (b * 1868 + g * 9617 + r * 4899 + (1 << 13)) >> 14; // same fixed point weights as cvtColor
+}
+
+#if CV_SIMD
+// isBoardColor on 16-bit lanes holding 8-bit values: all ones for the pixels of the board color
+static inline cv::v_uint16 boardColorMask(const cv::v_uint16 &b, const cv::v_uint16 &g, const cv::v_uint16 &r,
+                                          int lowSaturation, int highHue) {
+    using namespace cv;
+    v_uint16 v = v_max(v_max(b, g), r);
+    v_uint16 diff = v - v_min(v_min(b, g), r);
+    // 255 * diff + v / 2 <= 65152 fits in unsigned 16 bits
+    v_uint16 saturationOk = (diff * vx_setall_u16(255) + (v >> 1)) >= v * vx_setall_u16((ushort) lowSaturation);
+    if (lowSaturation > 0)
+        saturationOk = saturationOk & (v > vx_setzero_u16());
+
+    v_int16 sb = v_reinterpret_as_s16(b), sg = v_reinterpret_as_s16(g), sr = v_reinterpret_as_s16(r);
+    v_int16 sdiff = v_reinterpret_as_s16(diff);
+    v_int16 isRed = v_reinterpret_as_s16(v == r);
+    v_int16 isGreen = v_reinterpret_as_s16(v == g) & ~isRed;
+    v_int16 num = v_select(isRed, sg - sb, v_select(isGreen, sb - sr, sr - sg));
+    v_int16 scaled = num * vx_setall_s16(60);
+    v_int16 base = v_select(isRed,
+                            v_select(scaled < vx_setzero_s16() - sdiff, vx_setall_s16(180), vx_setzero_s16()),
+                            v_select(isGreen, vx_setall_s16(60), vx_setall_s16(120)));
+    v_int16 bound = v_min(v_max(vx_setall_s16((short) highHue) - base, vx_setall_s16(-31)), vx_setall_s16(31));
+    v_int16 hueOk = (scaled < (bound + bound + vx_setall_s16(1)) * sdiff) | (sdiff == vx_setzero_s16());
+    return saturationOk & v_reinterpret_as_u16(hueOk);
+}
+
+static inline cv::v_uint16 grayOf(const cv::v_uint16 &b, const cv::v_uint16 &g, const cv::v_uint16 &r) {
+    using namespace cv;
+    v_uint32 b0, b1, g0, g1, r0, r1;
+    v_mul_expand(b, vx_setall_u16(1868), b0, b1);
+    v_mul_expand(g, vx_setall_u16(9617), g0, g1);
+    v_mul_expand(r, vx_setall_u16(4899), r0, r1);
+    v_uint32 half = vx_setall_u32(1 << 13);
+    return v_pack((b0 + g0 + r0 + half) >> 14, (b1 + g1 + r1 + half) >> 14);
+}
+#endif
+
+// First sweep: gray receives the grayscale of the pixels that don't have the color of the board (0 for the others)
+// and its histogram is accumulated. When gated is given, it receives those pixels in BGR (0 for the others).
+static void gateBoardColor(const cv::Mat &src, int lowSaturation, int highHue,
+                           cv::Mat *gated, cv::Mat &gray, int *histogram) {
+    CV_Assert(src.type() == CV_8UC3);
+    gray.create(src.size(), CV_8UC1);
+    if (gated != nullptr)
+        gated->create(src.size(), CV_8UC3);
+
+    for (int y = 0; y < src.rows; ++y) {
+        const uchar *in = src.ptr<uchar>(y);
+        uchar *out = gated != nullptr ? gated->ptr<uchar>(y) : nullptr;
+        uchar *grayRow = gray.ptr<uchar>(y);
+        int x = 0;
+#if CV_SIMD
+        using namespace cv;
+        const int lanes = v_uint8::nlanes;
+        for (; x <= src.cols - lanes; x += lanes) {
+            v_uint8 b, g, r;
+            v_load_deinterleave(in + 3 * x, b, g, r);
+            v_uint16 b0, b1, g0, g1, r0, r1;
+            v_expand(b, b0, b1);
+            v_expand(g, g0, g1);
+            v_expand(r, r0, r1);
+            v_uint8 keep = ~v_pack(boardColorMask(b0, g0, r0, lowSaturation, highHue),
+                                   boardColorMask(b1, g1, r1, lowSaturation, highHue));
+            v_store(grayRow + x, v_pack(grayOf(b0, g0, r0), grayOf(b1, g1, r1)) & keep);
+            if (out != nullptr)
+                v_store_interleave(out + 3 * x, b & keep, g & keep, r & keep);
+            for (int i = 0; i < lanes; ++i) {
+                histogram[grayRow[x + i]]++;
+            }
+        }
+#endif
+        for (; x < src.cols; ++x) {
+            int b = in[3 * x], g = in[3 * x + 1], r = in[3 * x + 2];
+            bool keep = !isBoardColor(b, g, r, lowSaturation, highHue);
+            grayRow[x] = keep ? uchar(grayOf(b, g, r)) : 0;
+            if (out != nullptr) {
+                out[3 * x] = keep ? b : 0;
+                out[3 * x + 1] = keep ? g : 0;
+                out[3 * x + 2] = keep ? r : 0;
+            }
+            histogram[grayRow[x]]++;
+        }
+    }
+}
+
+// Otsu's threshold of an 8-bit histogram, computed as cv::threshold does
+static int otsuThreshold(const int *histogram, int total) {
+    double scale = 1.0 / total, mu = 0;
+    for (int i = 0; i < 256; ++i) {
+        mu += i * (double) histogram[i];
+    }
+    mu *= scale;
+
+    double mu1 = 0, q1 = 0, maxSigma = 0;
+    int threshold = 0;
+    for (int i = 0; i < 256; ++i) {
+        double p = histogram[i] * scale;
+        mu1 *= q1;
+        q1 += p;
+        double q2 = 1.0 - q1;
+        if (std::min(q1, q2) < FLT_EPSILON || std::max(q1, q2) > 1.0 - FLT_EPSILON)
+            continue;
+        mu1 = (mu1 + i * p) / q1;
+        double mu2 = (mu - q1 * mu1) / q2;
+        double sigma = q1 * q2 * (mu1 - mu2) * (mu1 - mu2);
+        if (sigma > maxSigma) {
+            maxSigma = sigma;
+            threshold = i;
+        }
+    }
+    return threshold;
+}
+
+// Second sweep: dst = (gray > threshold ? 255 : 0), minus the given edges. dst may be gray.
+static void binarizeWithoutEdges(const cv::Mat &gray, int threshold, const cv::Mat *edges, cv::Mat &dst) {
+    dst.create(gray.size(), CV_8UC1);
+    for (int y = 0; y < gray.rows; ++y) {
+        const uchar *in = gray.ptr<uchar>(y);
+        const uchar *edgeRow = edges != nullptr ? edges->ptr<uchar>(y) : nullptr;
+        uchar *out = dst.ptr<uchar>(y);
+        int x = 0;
+#if CV_SIMD
+        using namespace cv;
+        const int lanes = v_uint8::nlanes;
+        v_uint8 thresholds = vx_setall_u8((uchar) threshold);
+        for (; x <= gray.cols - lanes; x += lanes) {
+            v_uint8 binary = vx_load(in + x) > thresholds;
+            if (edgeRow != nullptr)
+                binary = binary & ~vx_load(edgeRow + x);
+            v_store(out + x, binary);
+        }
+#endif
+        for (; x < gray.cols; ++x) {
+            uchar binary = in[x] > threshold ? 255 : 0;
+            out[x] = edgeRow != nullptr ? uchar(binary & ~edgeRow[x]) : binary;
+        }
+    }
+}
+
+// Isolate the dices of src (BGR) into mask, as Deboggler::isolateBoggleDice does: no Canny edges when
+// cannyThreshold1 >= 255. gated and edges are working images, kept by the caller from one frame to the next: nothing
+// is allocated when mask, gated and edges already have the size of src. Return Otsu's threshold.
+static int segmentBoggleDice(const cv::Mat &src, cv::Mat &mask, int lowSaturation, int highHue, int cannyThreshold1,
+                              cv::Mat &gated, cv::Mat &edges) {
+    bool useEdges = cannyThreshold1 < 255;
+    int histogram[256] = {};
+    gateBoardColor(src, lowSaturation, highHue, useEdges ? &gated : nullptr, mask, histogram);
+    if (useEdges) {
+        cv::Canny(gated, edges, cannyThreshold1, 255);
+        cv::dilate(edges, edges, cv::Mat()); // default 3x3 rectangle, without allocating the kernel
+    }
+    int threshold = otsuThreshold(histogram, int(mask.total()));
+    binarizeWithoutEdges(mask, threshold, useEdges ? &edges : nullptr, mask);
+    return threshold;
+}
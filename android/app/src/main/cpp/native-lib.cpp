@@ -3,19 +3,45 @@
 #include <opencv2/core/core.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
 #include <functional>
+#include <memory>
 
 #define TAG "Deboggler_Native"
 
 #define FEEDFORWARD
 #include "ProcessImage.h"
+#include "DebogglerPool.h"
+#include "solutioner/dawg.h"
+#include "solutioner/solver.h"
 
 
-Mat mask;
+// frames may be processed on several threads at once, each one with its own Deboggler
+DebogglerPool& get_deboggler_pool() {
+    static DebogglerPool pool;
+    static std::once_flag configured;
+    std::call_once(configured, [] {
+        pool.configure([](Deboggler &deboggler) {
+            deboggler.logCallback = [](const char* fmt) {
+                __android_log_print(ANDROID_LOG_INFO, TAG, "%s\n", fmt);
+            };
+            // camera frames are 1080p: the board frame is found at half resolution
+            deboggler.detectionScale = 2;
+        });
+    });
+    return pool;
+}
 
+Dawg& get_dictionary() {
+    static Dawg dictionary;
+    return dictionary;
+}
 
-Deboggler& get_deboggler() {
-    static Deboggler deboggler;
-    return deboggler;
+// boards may be solved on several threads at once, each one reusing its own Solver: its word stamps are
+// allocated once for the dictionary instead of on every board
+Solver& get_solver() {
+    thread_local std::unique_ptr<Solver> solver;
+    if (!solver || solver->stamps.size() != get_dictionary().wordCount)
+        solver = std::make_unique<Solver>(get_dictionary());
+    return *solver;
 }
 
 extern "C" {
@@ -25,7 +51,11 @@ Java_com_rsahel_deboggler_CameraFragment_configureNeuralNetwork(JNIEnv *env, job
     __android_log_print(ANDROID_LOG_INFO, TAG, "configureNeuralNetwork\n");
     const char *path = env->GetStringUTFChars(jstr, nullptr);
     __android_log_print(ANDROID_LOG_INFO, TAG, "path to configuration: %s\n", path);
-    get_deboggler().neuralNetwork.deserialize(path);
+    get_deboggler_pool().configure([path](Deboggler &deboggler) {
+        deboggler.neuralNetwork.deserialize(path);
+        if (!deboggler.classifier.load(deboggler.neuralNetwork))
+            __android_log_print(ANDROID_LOG_INFO, TAG, "unexpected topology, the classifier is not used\n");
+    });
     __android_log_print(ANDROID_LOG_INFO, TAG, "configuration read\n");
     env->ReleaseStringUTFChars(jstr, path);
 }
@@ -36,27 +66,24 @@ int JNICALL
 Java_com_rsahel_deboggler_CameraFragment_deboggle(JNIEnv *env, jobject instance,
                                                   jlong srcAddr, jcharArray ptr
 ) {
-    auto& deboggler = get_deboggler();
+    auto deboggler = get_deboggler_pool().acquire();
     Mat &current = *(Mat *) srcAddr;
-    static bool initialize = true;
-    if (initialize) {
-        initialize = false;
-        deboggler.logCallback = [](const char* fmt) {
-            __android_log_print(ANDROID_LOG_INFO, TAG, "%s\n", fmt);
-        };
-        mask = cv::Mat::zeros(current.rows, current.cols, CV_8UC3);
-    }
+    Mat mask;
+    auto allocations = deboggler->workspace.allocations;
 
-    jchar *body = env->GetCharArrayElements(ptr, nullptr);
-    deboggler.guessedBoard = body;
+    jchar board[16] = {};
+    deboggler->guessedBoard = board;
 
     ProcessResult result = ProcessResult::PROCESS_FAILURE;
     try {
         cv::cvtColor(current, current, cv::COLOR_RGB2BGR);
-        result = deboggler.Process(current, mask);
+        result = deboggler->Process(current, mask);
+        if (deboggler->workspace.allocations != allocations) {
+            __android_log_print(ANDROID_LOG_INFO, TAG, "workspace allocations: %zu\n", deboggler->workspace.allocations);
+        }
 //    __android_log_print(ANDROID_LOG_INFO, TAG, "result: %d\n", result);
         if (result == ProcessResult::PROCESS_SUCCESS) {
-            env->SetCharArrayRegion(ptr, 0, 16, deboggler.guessedBoard);
+            env->SetCharArrayRegion(ptr, 0, 16, board);
         }
         cv::cvtColor(current, current, cv::COLOR_BGR2RGB);
     }
@@ -73,4 +100,39 @@ Java_com_rsahel_deboggler_CameraFragment_deboggle(JNIEnv *env, jobject instance,
 
     return int(result);
 }
-}
\ No newline at end of file
+
+jboolean JNICALL
+Java_com_rsahel_deboggler_Solutioner_loadDictionaryImage(JNIEnv *env, jobject instance, jstring jstr) {
+    const char *path = env->GetStringUTFChars(jstr, nullptr);
+    bool loaded = get_dictionary().load(path);
+    __android_log_print(ANDROID_LOG_INFO, TAG, "dictionary %s: %s\n", loaded ? "loaded" : "invalid", path);
+    env->ReleaseStringUTFChars(jstr, path);
+    return jboolean(loaded);
+}
+
+// Solve the given board (16 letters, row by row) and return one path for each word found, packed as
+// [length, cell0, ..., cell(length - 1)] one after the other: the words are read back from the board letters.
+jintArray JNICALL
+Java_com_rsahel_deboggler_Solutioner_solve(JNIEnv *env, jobject instance, jcharArray jboard) {
+    char board[Solver::CellCount] = {};
+    if (get_dictionary().nodeCount > 0 && env->GetArrayLength(jboard) >= Solver::CellCount) {
+        jchar *body = env->GetCharArrayElements(jboard, nullptr);
+        for (int i = 0; i < Solver::CellCount; ++i) {
+            board[i] = body[i] < 128 ? char(body[i]) : '\0';
+        }
+        env->ReleaseCharArrayElements(jboard, body, JNI_ABORT);
+    }
+
+    std::vector<jint> packed;
+    if (get_dictionary().nodeCount > 0) {
+        for (const auto &solution: get_solver().solve(board)) {
+            packed.push_back(solution.length);
+            packed.insert(packed.end(), solution.path, solution.path + solution.length);
+        }
+    }
+
+    jintArray result = env->NewIntArray(jsize(packed.size()));
+    env->SetIntArrayRegion(result, 0, jsize(packed.size()), packed.data());
+    return result;
+}
+}
@@ -14,6 +14,8 @@ import androidx.lifecycle.LiveData
 import androidx.lifecycle.MutableLiveData
 import androidx.lifecycle.ViewModel
 import com.rsahel.deboggler.databinding.ActivityMainBinding
+import java.io.File
+import java.io.FileOutputStream
 
 class SolutionViewModel : ViewModel() {
     private val solutions: MutableLiveData<List<SolutionItem>> by lazy {
@@ -25,8 +27,7 @@ class SolutionViewModel : ViewModel() {
     }
 
     fun loadSolutions(currentSolutions: List<SolutionItem>) {
-        var hashset = currentSolutions.toHashSet()
-        var sorted = hashset.sortedByDescending { it.value.length }
+        var sorted = currentSolutions.sortedByDescending { it.value.length }
         solutions.value = sorted;
     }
 
@@ -48,11 +49,25 @@ class MainActivity : AppCompatActivity() {
         binding = ActivityMainBinding.inflate(layoutInflater)
         setContentView(binding.root)
 
-        assets.open("french.txt").use {
-            solutioner = Solutioner()
-            Log.e(TAG, "Loading dictionary")
-            solutioner.loadDictionary(it)
-            Log.e(TAG, "Dictionary loaded")
+        solutioner = Solutioner()
+        Log.e(TAG, "Loading dictionary")
+        // the image is mapped in place so it must live in a real file: copy it out of the assets
+        // on first launch and whenever the app was updated or the image format changed
+        val dictionaryFile = File(filesDir, "french.dawg")
+        val lastUpdateTime = packageManager.getPackageInfo(packageName, 0).lastUpdateTime
+        if (!dictionaryFile.exists() || dictionaryFile.lastModified() < lastUpdateTime
+            || !solutioner.loadDictionary(dictionaryFile.absolutePath)) {
+            copyAsset("french.dawg", dictionaryFile)
+            solutioner.loadDictionary(dictionaryFile.absolutePath)
+        }
+        Log.e(TAG, "Dictionary loaded")
+    }
+
+    private fun copyAsset(name: String, file: File) {
+        assets.open(name).use { input ->
+            FileOutputStream(file).use { output ->
+                input.copyTo(output)
+            }
         }
     }
 
@@ -1,98 +1,41 @@
 package com.rsahel.deboggler
 
-import java.io.InputStream
-import java.util.*
-import kotlin.collections.HashMap
-
+// Board solver backed by the native DAWG solver (see native-lib.cpp)
 class Solutioner {
 
-    private lateinit var root: TrieNode
     private val boardWidth = 4;
     private val boardHeight = 4;
 
-    fun loadDictionary(input: InputStream) {
-        root = TrieNode()
-        input.bufferedReader().forEachLine {
-            root.insert(it)
-        }
+    // map the precompiled dictionary image (see dawgcompiler), false if it is missing or outdated
+    fun loadDictionary(path: String): Boolean {
+        return loadDictionaryImage(path)
     }
 
     fun findSolutions(letters: String): List<SolutionItem> {
-        var solutions = mutableListOf<SolutionItem>();
-        var board = Array(boardHeight, init = {
-            letters.subSequence(it * boardWidth, it * boardWidth + boardWidth)
-        })
-        var visited = Array(boardHeight, init = {
-            Array(boardWidth, init = {
-                false
-            })
-        })
-        for (i in 0 until boardWidth) {
-            for (j in 0 until boardHeight) {
-                findSolutions(solutions, board, visited, i, j, "", Stack());
-            }
+        val solutions = mutableListOf<SolutionItem>();
+        if (letters.length < boardWidth * boardHeight) {
+            return solutions
         }
-        return solutions
-    }
-
-    private fun findSolutions(
-        solutions: MutableList<SolutionItem>,
-        board: Array<CharSequence>,
-        visited: Array<Array<Boolean>>,
-        i: Int,
-        j: Int,
-        word: String,
-        indices: Stack<Int>
-    ) {
-        visited[i][j] = true;
-        indices.add(i * boardWidth + j)
-        val currentWord = word + board[i][j]
 
-        val node = root.search(currentWord)
-        if (node != null) {
-            if (node.isEndOfWord) {
-                solutions.add(SolutionItem(currentWord, indices.toList()))
-            }
-            for (k in i - 1..i + 1) {
-                for (l in j - 1..j + 1) {
-                    if (k in 0 until boardWidth && l in 0 until boardHeight && !visited[k][l]) {
-                        findSolutions(solutions, board, visited, k, l, currentWord, indices)
-                    }
-                }
-            }
+        // packed as [length, cell0, ..., cell(length - 1)] for each word found
+        val packed = solve(letters.toCharArray())
+        var i = 0
+        while (i < packed.size) {
+            val length = packed[i++]
+            val indices = packed.copyOfRange(i, i + length).toList()
+            val word = String(CharArray(length) { letters[indices[it]] })
+            solutions.add(SolutionItem(word, indices))
+            i += length
         }
-        visited[i][j] = false;
-        indices.pop()
+        return solutions
     }
 
-    class TrieNode {
-        var isEndOfWord = false;
-        var children = HashMap<Char, TrieNode>()
-
-        fun insert(word: String) {
-            var current = this;
-            for (i in word.indices) {
-                var item = current.children[word[i]]
-                if (item == null) {
-                    item = TrieNode()
-                    current.children[word[i]] = item
-                }
-                current = item;
-            }
-
-            current.isEndOfWord = true
-        }
+    private external fun loadDictionaryImage(path: String): Boolean
+    private external fun solve(board: CharArray): IntArray
 
-        fun search(word: String): TrieNode? {
-            var current = this;
-            for (i in word.indices) {
-                var item = current.children[word[i]]
-                if (item == null) {
-                    return null
-                }
-                current = item;
-            }
-            return current
+    companion object {
+        init {
+            System.loadLibrary("native-lib")
         }
     }
-}
\ No newline at end of file
+}
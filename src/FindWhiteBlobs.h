@@ -9,12 +9,21 @@
 #include "ProcessStep.h"
 
 struct FindWhiteBlobs : ProcessStep {
+    static constexpr int candidateCount = 8;
+
     bool autoSensitivity = true;
+    // try the valleys of the histogram before the sweep. Faster, but the first valley that leaves 16 blobs is often
+    // below the highest sensitivity that does, so the blobs are smaller than the ones of the sweep
+    bool histogramSensitivity = false;
     int sensitivity = 75;
     bool test = false;
     std::vector<std::vector<cv::Point> > contours;
+    // buffers of whitenessLevels and findCandidateSensitivities, kept from a frame to the next one
+    cv::Mat channels[3], levels;
+    std::vector<std::pair<int, int>> valleys;
 
-    FindWhiteBlobs(bool t = false) : test(t) {}
+    // there are at most 63 strict local minima in the 126 levels searched by findCandidateSensitivities
+    FindWhiteBlobs(bool t = false) : test(t) { valleys.reserve(63); }
     
     const char *GUILabel() override { return "Floodfill"; }
 
@@ -23,16 +32,39 @@ struct FindWhiteBlobs : ProcessStep {
         if (current.channels() == 1)
             cv::cvtColor(current, current, cv::COLOR_GRAY2BGR);    
         cv::cvtColor(current, current, cv::COLOR_BGR2HSV);
-        cv::Mat source = current.clone();
+        cv::Mat &source = whitenessLevels(current);
         cv::Rect safeArea(src.cols * 0.05f, src.rows * 0.05f, src.cols - src.cols * 0.05f, src.rows - src.rows * 0.05f);
         int idealArea = src.cols * src.rows / 4;
         int maxArea = idealArea * 1.5f;
         int minArea = idealArea * 0.01f;
         if (autoSensitivity) {
-            for (sensitivity = 127; sensitivity >= 0; sensitivity--) {
+            int histogram[256] = {};
+            for (int y = 0; y < source.rows; ++y) {
+                const uchar *row = source.ptr<uchar>(y);
+                for (int x = 0; x < source.cols; ++x) {
+                    histogram[row[x]]++;
+                }
+            }
+
+            bool found = false;
+            if (histogramSensitivity) {
+                int candidates[candidateCount];
+                int count = findCandidateSensitivities(histogram, candidates);
+                for (int i = 0; i < count && !found; ++i) {
+                    sensitivity = candidates[i];
+                    extractContours(current, source, contours, safeArea, minArea, maxArea);
+                    found = contours.size() == 16;
+                }
+            }
+            // otherwise sweep all the sensitivities, from the highest: the mask at a level is the one of the level above
+            // when no pixel is at that level above, so only the levels under a level present in the image are tried
+            for (int level = 127; level >= 0 && !found; level--) {
+                if (level < 127 && histogram[level + 1] == 0)
+                    continue;
+                sensitivity = level;
                 extractContours(current, source, contours, safeArea, minArea, maxArea);
-                if (contours.size() == 16) { 
-                    break; 
+                if (contours.size() == 16) {
+                    break;
                 }
             }
         } else {
@@ -56,9 +88,49 @@ struct FindWhiteBlobs : ProcessStep {
         return std::abs(b - a) < epsilon;
     }
 
+    // A pixel is white at a given sensitivity when its saturation is at most the sensitivity and its value at least
+    // 255 - sensitivity: produce the level of each pixel, max(S, 255 - V), the smallest sensitivity for which it is white.
+    cv::Mat &whitenessLevels(const cv::Mat &hsv) {
+        cv::split(hsv, channels);
+        cv::bitwise_not(channels[2], channels[2]);
+        cv::max(channels[1], channels[2], levels);
+        return levels;
+    }
+
+    // Pick the sensitivities worth trying from the histogram of the whiteness levels, from the highest to the lowest.
+    // Method: - the dices are the whitest blobs of the image: they are separated from the background at a valley of
+    //           the histogram, so the candidates are the local minima of the smoothed histogram below 128
+    //         - only the deepest valleys are kept (compared to the smallest of their two surrounding peaks)
+    int findCandidateSensitivities(const int *histogram, int *candidates) {
+        constexpr int radius = 2;
+        int smoothed[128];
+        for (int i = 0; i < 128; ++i) {
+            smoothed[i] = 0;
+            for (int k = std::max(0, i - radius); k <= std::min(255, i + radius); ++k) {
+                smoothed[i] += histogram[k];
+            }
+        }
+
+        valleys.clear(); // (depth, level)
+        for (int i = 1; i < 127; ++i) {
+            if (smoothed[i] > smoothed[i - 1] || smoothed[i] >= smoothed[i + 1])
+                continue;
+            int leftPeak = *std::max_element(smoothed, smoothed + i);
+            int rightPeak = *std::max_element(smoothed + i + 1, smoothed + 128);
+            valleys.emplace_back(std::min(leftPeak, rightPeak) - smoothed[i], i);
+        }
+        std::sort(valleys.begin(), valleys.end(), std::greater<>());
+
+        int count = std::min(int(valleys.size()), candidateCount);
+        for (int i = 0; i < count; ++i) {
+            candidates[i] = valleys[i].second;
+        }
+        std::sort(candidates, candidates + count, std::greater<>());
+        return count;
+    }
+
     void extractContours(cv::Mat &current, cv::Mat &source, std::vector<std::vector<cv::Point>> &contours, const cv::Rect& safeArea, int minArea, int maxArea) const {
-        cv::inRange(source, cv::Vec3b(0, 0, 255 - sensitivity), cv::Vec3b(255, sensitivity, 255), current);
-        cv::threshold(current, current, 127, 255, 0);
+        cv::threshold(source, current, sensitivity, 255, cv::THRESH_BINARY_INV);
         findContours(current, contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
         contours.erase(
                 std::remove_if(contours.begin(), contours.end(),
@@ -76,6 +148,7 @@ struct FindWhiteBlobs : ProcessStep {
     bool DrawGUI(const cv::Rect &window) override {
         bool hasChanged = false;
         cvui::checkbox("Auto-sensitivity", &autoSensitivity);
+        cvui::checkbox("Histogram", &histogramSensitivity);
         hasChanged |= trackbar("Sensitivity", window, sensitivity, 0, 255);
         return hasChanged;
     }
@@ -8,6 +8,7 @@
 #include "commons.h"
 #include "ProcessStep.h"
 #include "FindWhiteBlobs.h"
+#include "../android/app/src/main/cpp/Quadrilateral.h"
 
 struct MergeWhiteBlobs : ProcessStep {
     bool autoCompute = true;
@@ -36,16 +37,11 @@ struct MergeWhiteBlobs : ProcessStep {
             std::vector<std::vector<cv::Point> > hull(contours.size());
             convexHull(contours[0], hull[0]);
 
-            auto peri = cv::arcLength(hull[0], true);
-            std::vector<cv::Point> simplifiedHull = hull[0];
+            std::vector<cv::Point> simplifiedHull;
             if (autoCompute) {
-                for (epsilon = 0.12; epsilon < 10.0; epsilon += 0.01) {
-                    simplifyHull(peri, hull[0], simplifiedHull);
-                    if (simplifiedHull.size() <= 4)
-                        break;
-                }
+                epsilon = fitQuadrilateral(hull[0], simplifiedHull);
             } else {
-                simplifyHull(peri, hull[0], simplifiedHull);
+                simplifyHull(cv::arcLength(hull[0], true), hull[0], simplifiedHull);
             }
             hull[0] = simplifiedHull;
             fourPointTransform(src, current, simplifiedHull);
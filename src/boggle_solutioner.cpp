@@ -3,96 +3,182 @@
 //
 
 #include <string>
+#include <cstring>
 #include <iostream>
-#include <unordered_map>
+#include <fstream>
+#include <filesystem>
+#include <chrono>
+
+#include "solutioner/trie.h"
+#include "solutioner/dawg.h"
+#include "solutioner/solver.h"
+#include "solutioner/rules.h"
+#include "solutioner/work_stealing_pool.h"
 
 using namespace std;
 
-#define M 4
-#define N 4
-
-// Let the given dictionary be following
-string dictionary[] = {"GEEKS", "GEEK", "FOR", "QUIZ", "GO"};
-int n = sizeof(dictionary) / sizeof(dictionary[0]);
-
-struct TrieNode {
-    std::unordered_map<char, TrieNode> children;
-    bool isEndOfWord = false;
-};
-
-void insert(TrieNode &root, string word) {
-    TrieNode *current = &root;
-    for (int i = 0; i < word.size(); ++i) {
-        auto item = current->children.find(word[i]);
-        if (item != current->children.end()) {
-            current = &item->second;
-        } else {
-            current->children.emplace(word[i], TrieNode{});
-            current = &current->children[word[i]];
+constexpr const char *dictionaryPath = "../french.txt";
+constexpr const char *dawgPath = "../android/app/src/main/assets/french.dawg";
+
+// load the precompiled DAWG image (see dawgcompiler), or build the DAWG from a word list
+bool loadDictionary(const char *path, Dawg &dawg) {
+    auto start = std::chrono::steady_clock::now();
+    if (std::filesystem::path(path).extension() == ".dawg") {
+        if (!dawg.load(path)) {
+            cout << "Invalid or outdated dictionary image " << path << " (version " << DawgVersion << " expected, run dawgcompiler)" << endl;
+            return false;
+        }
+    } else {
+        std::vector<std::string> words;
+        if (!readWords(path, words)) {
+            cout << "Could not read dictionary " << path << endl;
+            return false;
         }
+        dawg = Dawg::build(Trie::build(words));
     }
-    current->isEndOfWord = true;
+    auto duration = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start);
+    cout << dawg.nodeCount << " nodes, " << dawg.edgeCount << " edges (" << dawg.memoryFootprint() / 1024 << " KB) loaded in "
+         << duration.count() << " ms" << endl;
+    return true;
 }
 
-const TrieNode* search(const TrieNode &root, string word) {
-    const TrieNode *current = &root;
-    for (int i = 0; i < word.size(); ++i) {
-        auto item = current->children.find(word[i]);
-        if (item != current->children.end()) {
-            current = &item->second;
-        } else {
-            return nullptr;
+// call function with std::integral_constant<int, Size>() for a Size x Size board of the given number of cells:
+// each supported size gets its own compiled solver
+template<typename Function>
+int withBoardSize(size_t cellCount, Function &&function) {
+    switch (cellCount) {
+        case 16:
+            return function(std::integral_constant<int, 4>());
+        case 25:
+            return function(std::integral_constant<int, 5>());
+        case 36:
+            return function(std::integral_constant<int, 6>());
+        default:
+            cout << "Unsupported board of " << cellCount << " letters (4x4, 5x5 and 6x6 are supported)" << endl;
+            return 1;
+    }
+}
+
+// Read boards from a file (one board per line, all of the same size) or roll count 4x4 boards with the french dice.
+// Return the number of cells of the boards.
+size_t readBoards(const char *source, unsigned seed, std::vector<char> &boards) {
+    size_t cellCount = 16;
+    if (std::filesystem::exists(source)) {
+        std::ifstream fs(source);
+        std::string line;
+        cellCount = 0;
+        while (std::getline(fs, line)) {
+            if (!line.empty() && line.back() == '\r')
+                line.pop_back();
+            if (cellCount == 0)
+                cellCount = line.size();
+            if (!line.empty() && line.size() == cellCount)
+                boards.insert(boards.end(), line.begin(), line.end());
+        }
+    } else {
+        size_t count = std::strtoull(source, nullptr, 10);
+        boards.resize(count * cellCount);
+        std::mt19937 random(seed);
+        for (size_t i = 0; i < count; ++i) {
+            rollBoard(random, &boards[i * cellCount]);
         }
     }
-    return current;
+    return cellCount;
 }
 
+// Solve a batch of boards on all the cores and report statistics.
+template<int Rows, int Cols>
+int runBatch(const Dawg &dawg, const std::vector<char> &boards) {
+    using BatchSolver = BoardSolver<Rows, Cols>;
+    constexpr int CellCount = BatchSolver::CellCount;
+    size_t count = boards.size() / CellCount;
 
-void searchWordFrom(int i, int j, char boggle[M][N], bool visited[M][N], string &word, const TrieNode& root) {
+    struct WorkerStats {
+        size_t words = 0;
+        size_t score = 0;
+        int bestScore = -1;
+        size_t bestBoard = 0;
+    };
 
-    visited[i][j] = true;
-    word += boggle[i][j];
+    WorkStealingPool pool;
+    std::vector<WorkerStats> stats(pool.threadCount);
+    std::vector<BatchSolver> solvers(pool.threadCount, BatchSolver(dawg));
 
-    auto current = search(root, word);
-    if (current != nullptr) {
-        if (current->isEndOfWord) {
-            std::cout << word << std::endl;
+    auto start = std::chrono::steady_clock::now();
+    pool.run(count, [&](size_t index, unsigned worker) {
+        auto &current = stats[worker];
+        const auto &solutions = solvers[worker].solve(&boards[index * CellCount]);
+        int score = 0;
+        for (const auto &solution: solutions) {
+            score += wordScore(solution.length);
         }
-        for (int k = i - 1; k <= i + 1 && k < M; ++k) {
-            for (int l = j - 1; l <= j + 1 && l < N; ++l) {
-                if (k >= 0 && l >= 0 && !visited[k][l])
-                    searchWordFrom(k, l, boggle, visited, word, root);
-            }
+        current.words += solutions.size();
+        current.score += score;
+        if (score > current.bestScore) {
+            current.bestScore = score;
+            current.bestBoard = index;
         }
-    }
-
-    word.erase(word.size() - 1);
-    visited[i][j] = false;
-}
+    });
+    auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
 
-// Prints all words present in dictionary.
-void findWords(char boggle[M][N], const TrieNode& root) {
-    bool visited[M][N] = {{false}};
-    string word = "";
-    for (int i = 0; i < M; ++i) {
-        for (int j = 0; j < N; ++j) {
-            searchWordFrom(i, j, boggle, visited, word, root);
+    WorkerStats total;
+    for (const auto &current: stats) {
+        total.words += current.words;
+        total.score += current.score;
+        if (current.bestScore > total.bestScore) {
+            total.bestScore = current.bestScore;
+            total.bestBoard = current.bestBoard;
         }
     }
+
+    cout << count << " " << Rows << "x" << Cols << " boards solved on " << pool.threadCount << " threads in " << seconds << " s ("
+         << size_t(double(count) / seconds) << " boards/s)" << endl;
+    cout << "Average: " << double(total.words) / double(count) << " words, "
+         << double(total.score) / double(count) << " points per board" << endl;
+    cout << "Best board: " << std::string(&boards[total.bestBoard * CellCount], CellCount)
+         << " (" << total.bestScore << " points)" << endl;
+    return 0;
 }
 
-// Driver program to test above function
-int main() {
-    char boggle[M][N] = {{'G', 'I', 'Z', 'S'},
-                         {'U', 'E', 'K', 'F'},
-                         {'Q', 'S', 'E', 'B'}};
+// usage: solutioner [dictionary.txt|dictionary.dawg] [board of 16, 25 or 36 letters]
+//        solutioner batch <boards.txt|count> [seed] [dictionary.txt|dictionary.dawg]
+int main(int argc, const char *argv[]) {
+    bool isBatch = argc > 1 && std::strcmp(argv[1], "batch") == 0;
+    int dictionaryArg = isBatch ? 4 : 1;
 
-    
-    TrieNode root;
-    for (int i = 0; i < n; ++i) {
-        insert(root, dictionary[i]);
+    // use the precompiled DAWG when available, build it from the word list otherwise
+    const char *path = argc > dictionaryArg ? argv[dictionaryArg] : (std::filesystem::exists(dawgPath) ? dawgPath : dictionaryPath);
+    Dawg dawg;
+    if (!loadDictionary(path, dawg))
+        return 1;
+
+    if (isBatch) {
+        std::vector<char> boards;
+        const char *source = argc > 2 ? argv[2] : "100000";
+        size_t cellCount = readBoards(source, argc > 3 ? unsigned(std::stoul(argv[3])) : 0u, boards);
+        if (boards.empty()) {
+            cout << "No board to solve in " << source << endl;
+            return 1;
+        }
+        return withBoardSize(cellCount, [&](auto size) {
+            constexpr int Size = decltype(size)::value;
+            return runBatch<Size, Size>(dawg, boards);
+        });
     }
-    cout << "Following words of dictionary are present\n";
-    findWords(boggle, root);
-    return 0;
-}
\ No newline at end of file
+
+    const char *boggle = argc > 2 ? argv[2] : "LRFT"
+                                              "AGLE"
+                                              "NETA"
+                                              "ITSA";
+    return withBoardSize(std::char_traits<char>::length(boggle), [&](auto size) {
+        constexpr int Size = decltype(size)::value;
+        cout << "Following words of dictionary are present\n";
+        BoardSolver<Size, Size> solver(dawg);
+        char word[Size * Size + 1];
+        for (const auto &solution: solver.solve(boggle)) {
+            dawg.wordAt(solution.wordIndex, word);
+            cout << word << endl;
+        }
+        return 0;
+    });
+}
@@ -1,4 +1,11 @@
 #include <iostream>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <new>
 #include <opencv2/highgui/highgui.hpp>
 
 #include "commons.h"
@@ -11,15 +18,62 @@
 #define WRITE_IMAGE
 
 #include "../android/app/src/main/cpp/ProcessImage.h"
+#include "solutioner/work_stealing_pool.h"
+
+// Heap allocations of the whole process, to check what Deboggler::Process still allocates once its workspace is
+// warmed up (see runAllocationCheck): operator new sees the std containers and the temporary buffers of OpenCV,
+// CountingMatAllocator the data of the cv::Mat (each of them is also a heap allocation, for its UMatData).
+std::atomic<size_t> heapAllocations{0};
+
+void *operator new(std::size_t size) {
+    heapAllocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size != 0 ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept {
+    std::free(p);
+}
+
+struct CountingMatAllocator : cv::MatAllocator {
+    const cv::MatAllocator *allocator = cv::Mat::getStdAllocator();
+    mutable std::atomic<size_t> allocations{0};
+
+    cv::UMatData *allocate(int dims, const int *sizes, int type, void *data, size_t *step,
+                           cv::AccessFlag flags, cv::UMatUsageFlags usage) const override {
+        if (data == nullptr)
+            allocations.fetch_add(1, std::memory_order_relaxed);
+        return allocator->allocate(dims, sizes, type, data, step, flags, usage);
+    }
+
+    bool allocate(cv::UMatData *data, cv::AccessFlag flags, cv::UMatUsageFlags usage) const override {
+        return allocator->allocate(data, flags, usage);
+    }
+
+    void deallocate(cv::UMatData *data) const override {
+        allocator->deallocate(data);
+    }
+};
 
 struct DebogglerStep : ProcessStep {
     Assembly &assembly;
     Deboggler deboggler;
     NeuralNetwork neuralNetwork;
+    LetterClassifier classifier;
+    QuantizedLetterClassifier quantizedClassifier;
+    uint16_t guessedBoard[16] = {};
     int maxStep = int(ProcessResult::PROCESS_SUCCESS);
 
     DebogglerStep(Assembly &assembly) : assembly(assembly) {
         neuralNetwork.deserialize("../neuralNetwork.bin");
+        classifier.load(neuralNetwork);
+        // written by quantizer
+        quantizedClassifier.load("../neuralNetwork.q8");
     }
 
     const char *GUILabel() override { return "Deboggler Step"; }
@@ -27,9 +81,11 @@ struct DebogglerStep : ProcessStep {
     void Reset(const cv::Mat &src) {
         deboggler = Deboggler();
         deboggler.imageName = assembly.targets[assembly.sourceIndex];
-        static uint16_t guessedBoard[16];
         deboggler.guessedBoard = guessedBoard;
         deboggler.neuralNetwork = neuralNetwork;
+        deboggler.classifier = classifier;
+        deboggler.quantizedClassifier = quantizedClassifier;
+        deboggler.quantizedClassifierEnabled = quantizedClassifier.isLoaded();
     }
 
     void Process(const cv::Mat &src, cv::Mat &current) override {
@@ -40,9 +96,13 @@ struct DebogglerStep : ProcessStep {
         deboggler.maxStep = ProcessResult(maxStep);
 
         current = src;
-        cv::Mat mask = cv::Mat::zeros(src.rows, src.cols, CV_8UC3);
+        cv::Mat mask;
 
         auto result = deboggler.Process(current, mask);
+        if (deboggler.workspace.allocations != previousAllocations) {
+            previousAllocations = deboggler.workspace.allocations;
+            std::cout << "Workspace allocations: " << previousAllocations << std::endl;
+        }
 //        if (result >= ProcessResult::WARPED) {
 //            if (deboggler.warpedMat.channels() == 1) {
 //                cv::cvtColor(deboggler.warpedMat, deboggler.warpedMat, cv::COLOR_GRAY2RGB);
@@ -88,15 +148,180 @@ struct DebogglerStep : ProcessStep {
         hasChanged |= trackbar("sat", window, deboggler.low_s, 0, 255);
         hasChanged |= trackbar("hue", window, deboggler.high_h, 0, 255);
         hasChanged |= trackbar("canny", window, deboggler.canny_threshold, 0, 255);
+        hasChanged |= trackbar("scale", window, deboggler.detectionScale, 1, 4);
+        hasChanged |= trackbar("board", window, deboggler.canonicalBoardSize, 0, 32 * Deboggler::characterSize);
+        hasChanged |= cvui::checkbox("Fused segmentation", &deboggler.fusedSegmentation);
+        hasChanged |= cvui::checkbox("Direct sampling", &deboggler.directSampling);
+        hasChanged |= cvui::checkbox("SIMD classifier", &deboggler.fixedClassifier);
+        if (quantizedClassifier.isLoaded())
+            hasChanged |= cvui::checkbox("Int8 classifier", &deboggler.quantizedClassifierEnabled);
 
         return hasChanged;
     }
 
     int previousIndex = -1;
+    size_t previousAllocations = 0;
 };
 
 
+// Process all the images on all the cores, one Deboggler per worker, and count the boards read correctly.
+// imageName stays empty so the workers don't write their characters to ../output (same names, and disk I/O in the timing).
+int runBatch(unsigned threadCount) {
+    std::vector<std::string> sources;
+    cv::glob("../images/*.jpg", sources, false);
+    NeuralNetwork neuralNetwork;
+    neuralNetwork.deserialize("../neuralNetwork.bin");
+
+    WorkStealingPool pool(threadCount);
+    std::vector<Deboggler> debogglers(pool.threadCount);
+    std::vector<std::array<uint16_t, 16>> boards(pool.threadCount);
+    LetterClassifier classifier;
+    classifier.load(neuralNetwork);
+    for (auto &deboggler: debogglers) {
+        deboggler.neuralNetwork = neuralNetwork;
+        deboggler.classifier = classifier;
+    }
+    std::vector<char> correct(sources.size(), 0);
+
+    auto start = std::chrono::steady_clock::now();
+    pool.run(sources.size(), [&](size_t index, unsigned worker) {
+        auto &deboggler = debogglers[worker];
+        auto name = std::filesystem::path(sources[index]).stem().string();
+        deboggler.guessedBoard = boards[worker].data();
+        cv::Mat src = cv::imread(sources[index]), mask;
+        if (src.empty() || deboggler.Process(src, mask) != ProcessResult::PROCESS_SUCCESS)
+            return;
+        bool incorrect = name.size() < 16;
+        for (int i = 0; i < 16 && !incorrect; ++i) {
+            incorrect |= deboggler.guessedBoard[i] != name[i];
+        }
+        correct[index] = !incorrect;
+    });
+    auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    size_t correctCount = std::count(correct.begin(), correct.end(), 1);
+    std::cout << sources.size() << " images processed on " << pool.threadCount << " threads in " << seconds << " s ("
+              << double(sources.size()) / seconds << " images/s), " << correctCount << " boards read correctly" << std::endl;
+    return 0;
+}
+
+// Process each image with one Deboggler until its workspace is warmed up, then passes more times. Frames of the same
+// size must not grow the workspace, the allocations left are the ones inside OpenCV (findContours, floodFill, Canny,
+// minAreaRect...): they must not grow from a pass to the next one, nor exceed budget per frame when it is given.
+// Prints the heap and cv::Mat allocations per frame of each image after the warm-up, fails if one of these is not met.
+int runAllocationCheck(int passes, long budget) {
+    std::vector<std::string> sources;
+    cv::glob("../images/*.jpg", sources, false);
+    Deboggler deboggler;
+    deboggler.neuralNetwork.deserialize("../neuralNetwork.bin");
+    deboggler.classifier.load(deboggler.neuralNetwork);
+    std::array<uint16_t, 16> board{};
+    deboggler.guessedBoard = board.data();
+
+    CountingMatAllocator matAllocator;
+    cv::Mat::setDefaultAllocator(&matAllocator);
+    size_t failures = 0, largest = 0;
+    for (const auto &source: sources) {
+        cv::Mat frame = cv::imread(source), src, mask;
+        frame.copyTo(src);
+        deboggler.Process(src, mask);
+        auto workspaceAllocations = deboggler.workspace.allocations;
+
+        size_t heap = 0, mats = 0, first = 0;
+        bool grows = false;
+        for (int pass = 0; pass < passes; ++pass) {
+            frame.copyTo(src);
+            size_t heapBefore = heapAllocations, matBefore = matAllocator.allocations;
+            deboggler.Process(src, mask);
+            size_t passHeap = heapAllocations - heapBefore, passMats = matAllocator.allocations - matBefore;
+            if (pass == 0)
+                first = passHeap + passMats;
+            grows |= passHeap + passMats > first;
+            largest = std::max(largest, passHeap + passMats);
+            heap += passHeap;
+            mats += passMats;
+        }
+        grows |= deboggler.workspace.allocations != workspaceAllocations;
+        bool overBudget = budget >= 0 && (heap + mats) > size_t(budget) * passes;
+        failures += grows || overBudget;
+        std::cout << std::filesystem::path(source).stem().string() << ": " << double(heap) / passes
+                  << " heap and " << double(mats) / passes << " cv::Mat allocations per frame"
+                  << (grows ? ", growing" : "") << (overBudget ? ", over budget" : "") << std::endl;
+    }
+    cv::Mat::setDefaultAllocator(nullptr);
+
+    std::cout << "At most " << largest << " allocations per frame after the warm-up on " << sources.size() << " images, "
+              << failures << " failing" << std::endl;
+    return failures == 0 ? 0 : 1;
+}
+
+// Process each image with the characters cut out of the segmented warped board, then with directSampling, and compare
+// their characters (the part of the pixels that differ once binarized) and their guessed boards.
+int runSamplingCheck() {
+    std::vector<std::string> sources;
+    cv::glob("../images/*.jpg", sources, false);
+    Deboggler deboggler;
+    deboggler.neuralNetwork.deserialize("../neuralNetwork.bin");
+    deboggler.classifier.load(deboggler.neuralNetwork);
+    std::array<uint16_t, 16> classicBoard{}, directBoard{};
+    auto guessOf = [](const std::array<uint16_t, 16> &board) {
+        return std::string(board.begin(), board.end());
+    };
+
+    size_t processed = 0, sameBoards = 0, classicCorrect = 0, directCorrect = 0;
+    double differingPixels = 0;
+    for (const auto &source: sources) {
+        auto name = std::filesystem::path(source).stem().string().substr(0, 16);
+        cv::Mat frame = cv::imread(source), src, mask, classicCharacters, difference;
+        if (frame.empty())
+            continue;
+        // the characters are the rows of samples for the classifier, the columns of inputs for the neural network
+        auto &characters = deboggler.classifier.isLoaded() ? deboggler.workspace.samples : deboggler.workspace.inputs;
+
+        frame.copyTo(src);
+        deboggler.directSampling = false;
+        deboggler.guessedBoard = classicBoard.data();
+        if (deboggler.Process(src, mask) < ProcessResult::PROCESS_SUCCESS)
+            continue;
+        characters.view.copyTo(classicCharacters);
+
+        frame.copyTo(src);
+        deboggler.directSampling = true;
+        deboggler.guessedBoard = directBoard.data();
+        bool directProcessed = deboggler.Process(src, mask) >= ProcessResult::PROCESS_SUCCESS;
+
+        double differing = 1;
+        if (directProcessed) {
+            cv::absdiff(classicCharacters > 0.5f, characters.view > 0.5f, difference);
+            differing = double(cv::countNonZero(difference)) / double(difference.total());
+        }
+        processed++;
+        differingPixels += differing;
+        sameBoards += directProcessed && classicBoard == directBoard;
+        classicCorrect += guessOf(classicBoard) == name;
+        directCorrect += directProcessed && guessOf(directBoard) == name;
+        std::cout << name << ": " << differing * 100 << "% of the pixels differ, classic " << guessOf(classicBoard)
+                  << ", direct " << (directProcessed ? guessOf(directBoard) : "failed") << std::endl;
+    }
+
+    std::cout << processed << " boards: " << differingPixels * 100 / double(std::max<size_t>(processed, 1))
+              << "% of the pixels differ on average, " << sameBoards << " same boards, " << classicCorrect
+              << " read correctly by the classic crops, " << directCorrect << " by directSampling" << std::endl;
+    return 0;
+}
+
+// usage: deboggler
+//        deboggler batch [threadCount]
+//        deboggler allocations [passes] [budget of allocations per frame]
+//        deboggler sampling
 int main(int argc, const char *argv[]) {
+    if (argc > 1 && std::strcmp(argv[1], "batch") == 0)
+        return runBatch(argc > 2 ? unsigned(std::stoul(argv[2])) : std::thread::hardware_concurrency());
+    if (argc > 1 && std::strcmp(argv[1], "allocations") == 0)
+        return runAllocationCheck(argc > 2 ? std::max(1, std::atoi(argv[2])) : 3, argc > 3 ? std::atol(argv[3]) : -1);
+    if (argc > 1 && std::strcmp(argv[1], "sampling") == 0)
+        return runSamplingCheck();
+
     Assembly assembly;
     if (false) {
         assembly.push_back(new FindWhiteBlobs());
@@ -0,0 +1,118 @@
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+
+#include <opencv2/imgcodecs.hpp>
+
+#include "neuralnetwork.h"
+#include "classifier.h"
+
+// Benchmark of the letter recognition of a board (16 characters) with neuralNetwork.bin, printed as JSON:
+// - "mat": NeuralNetwork::feed_forward on each character, as the pipeline did
+// - "mat_batched": the batched NeuralNetwork::feed_forward of the pipeline, one GEMM per layer
+// - "classifier": LetterClassifier, the fixed topology SIMD version
+// The characters are the crops of output/ when there are some, random binary characters otherwise.
+// usage: classifierbenchmark [boardCount] [seed]
+
+constexpr const char *networkPath = "../neuralNetwork.bin";
+constexpr const char *charactersPath = "../output/*.jpg";
+constexpr int LetterCount = 16;
+
+using Clock = std::chrono::steady_clock;
+
+// characters as samples (one row of 784 values in [0, 1] each)
+cv::Mat readCharacters(size_t count, unsigned seed) {
+    std::vector<cv::String> paths;
+    if (std::filesystem::is_directory("../output"))
+        cv::glob(charactersPath, paths, false);
+
+    cv::Mat samples(int(count), 28 * 28, CV_32FC1);
+    std::mt19937 random(seed);
+    for (int i = 0; i < samples.rows; ++i) {
+        cv::Mat character = paths.empty() ? cv::Mat() : cv::imread(paths[i % paths.size()], cv::IMREAD_GRAYSCALE);
+        cv::Mat sample = samples.row(i);
+        if (character.total() == 28 * 28) {
+            character.reshape(1, 1).convertTo(sample, CV_32FC1, 1.0f / 255.0f);
+        } else {
+            auto *values = sample.ptr<float>(0);
+            for (int k = 0; k < samples.cols; ++k) {
+                values[k] = random() % 3 == 0 ? 0.0f : 1.0f;
+            }
+        }
+    }
+    return samples;
+}
+
+template<typename Function>
+double microsecondsPerBoard(size_t boardCount, Function &&function) {
+    auto start = Clock::now();
+    for (size_t i = 0; i < boardCount; ++i) {
+        function(i);
+    }
+    return std::chrono::duration<double, std::micro>(Clock::now() - start).count() / double(boardCount);
+}
+
+int main(int argc, const char *argv[]) {
+    size_t boardCount = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 2000;
+    unsigned seed = argc > 2 ? unsigned(std::stoul(argv[2])) : 0u;
+
+    NeuralNetwork neuralNetwork;
+    neuralNetwork.deserialize(networkPath);
+    LetterClassifier classifier;
+    if (!classifier.load(neuralNetwork)) {
+        std::cerr << "Could not load " << networkPath << " (a 784-128-26 network is expected)" << std::endl;
+        return 1;
+    }
+
+    auto samples = readCharacters(boardCount * LetterCount, seed);
+    cv::Mat inputs = samples.t();
+    cv::Mat matOutputs(26, samples.rows, CV_32FC1), classifierOutputs(samples.rows, 26, CV_32FC1);
+
+    double perLetter = microsecondsPerBoard(boardCount, [&](size_t board) {
+        for (int i = 0; i < LetterCount; ++i) {
+            int index = int(board) * LetterCount + i;
+            neuralNetwork.feed_forward(inputs.col(index).clone()).copyTo(matOutputs.col(index));
+        }
+    });
+
+    cv::Mat boardInputs(inputs.rows, LetterCount, CV_32FC1);
+    std::vector<cv::Mat> layers;
+    double batched = microsecondsPerBoard(boardCount, [&](size_t board) {
+        inputs.colRange(int(board) * LetterCount, int(board + 1) * LetterCount).copyTo(boardInputs);
+        neuralNetwork.feed_forward(boardInputs, layers);
+    });
+
+    double fixed = microsecondsPerBoard(boardCount, [&](size_t board) {
+        int first = int(board) * LetterCount;
+        classifier.feed_forward(samples.ptr<float>(first), LetterCount, classifierOutputs.ptr<float>(first));
+    });
+
+    // the outputs of the classifier against the ones of the cv::Mat path
+    cv::Mat difference = cv::abs(matOutputs.t() - classifierOutputs);
+    double maximumDifference = 0;
+    cv::minMaxLoc(difference, nullptr, &maximumDifference);
+    size_t sameLetters = 0;
+    for (int i = 0; i < samples.rows; ++i) {
+        int matBest = 0, classifierBest = 0;
+        for (int k = 1; k < 26; ++k) {
+            if (matOutputs.at<float>(k, i) > matOutputs.at<float>(matBest, i))
+                matBest = k;
+            if (classifierOutputs.at<float>(i, k) > classifierOutputs.at<float>(i, classifierBest))
+                classifierBest = k;
+        }
+        sameLetters += matBest == classifierBest;
+    }
+
+    std::cout << "{\n"
+              << "  \"boards\": " << boardCount << ",\n"
+              << "  \"latency_us_per_board\": {\n"
+              << "    \"mat\": " << perLetter << ",\n"
+              << "    \"mat_batched\": " << batched << ",\n"
+              << "    \"classifier\": " << fixed << "\n"
+              << "  },\n"
+              << "  \"speedup\": {\"mat\": " << perLetter / fixed << ", \"mat_batched\": " << batched / fixed << "},\n"
+              << "  \"max_abs_difference\": " << maximumDifference << ",\n"
+              << "  \"same_letters\": " << double(sameLetters) / double(samples.rows) << "\n"
+              << "}" << std::endl;
+    return 0;
+}
@@ -0,0 +1,205 @@
+#ifndef DEBOGGLER_CLASSIFIER_H
+#define DEBOGGLER_CLASSIFIER_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+#include <opencv2/core/hal/intrin.hpp>
+
+#include "neuralnetwork.h"
+
+// Exponential of the sigmoid of the classifiers: 2^n * e^r with x = n * ln(2) + r and |r| <= ln(2) / 2, e^r being a
+// polynomial (the one of Cephes' expf, a relative error of about 1e-7 on the whole range).
+namespace fastexp {
+constexpr float log2e = 1.44269504088896341f, ln2High = 0.693359375f, ln2Low = -2.12194440e-4f;
+constexpr float maximum = 88.3762626647949f, minimum = -87.3365447505531f;
+constexpr float p0 = 1.9875691500e-4f, p1 = 1.3981999507e-3f, p2 = 8.3334519073e-3f;
+constexpr float p3 = 4.1665795894e-2f, p4 = 1.6666665459e-1f, p5 = 5.0000001201e-1f;
+
+inline float exp(float x)
+{
+    x = std::min(std::max(x, minimum), maximum);
+    float n = std::nearbyint(x * log2e);
+    float r = x - n * ln2High - n * ln2Low;
+    float y = ((((p0 * r + p1) * r + p2) * r + p3) * r + p4) * r + p5;
+    y = y * r * r + r + 1.0f;
+    int32_t bits = (int32_t(n) + 127) << 23;
+    float scale;
+    std::memcpy(&scale, &bits, sizeof(scale));
+    return y * scale;
+}
+
+#if CV_SIMD
+inline cv::v_float32 exp(const cv::v_float32 &value)
+{
+    using namespace cv;
+    v_float32 x = v_min(v_max(value, vx_setall_f32(minimum)), vx_setall_f32(maximum));
+    v_int32 n = v_round(x * vx_setall_f32(log2e));
+    v_float32 fn = v_cvt_f32(n);
+    v_float32 r = x - fn * vx_setall_f32(ln2High) - fn * vx_setall_f32(ln2Low);
+    v_float32 y = v_fma(vx_setall_f32(p0), r, vx_setall_f32(p1));
+    y = v_fma(y, r, vx_setall_f32(p2));
+    y = v_fma(y, r, vx_setall_f32(p3));
+    y = v_fma(y, r, vx_setall_f32(p4));
+    y = v_fma(y, r, vx_setall_f32(p5));
+    y = v_fma(y, r * r, r + vx_setall_f32(1.0f));
+    return y * v_reinterpret_as_f32((n + vx_setall_s32(127)) << 23);
+}
+#endif
+
+// values[i] = 1 / (1 + e^-values[i])
+inline void sigmoid(float *values, int size)
+{
+    int i = 0;
+#if CV_SIMD
+    using namespace cv;
+    const v_float32 one = vx_setall_f32(1.0f);
+    for (; i <= size - v_float32::nlanes; i += v_float32::nlanes)
+        v_store(values + i, one / (one + fastexp::exp(vx_setzero_f32() - vx_load(values + i))));
+#endif
+    for (; i < size; ++i)
+        values[i] = 1.0f / (1.0f + fastexp::exp(-values[i]));
+}
+}
+
+// Inference only version of NeuralNetwork, compiled for one topology: Inputs -> Hiddens -> Outputs, sigmoid on both
+// layers. The weights are loaded from a NeuralNetwork (or its file) into aligned contiguous arrays, shared by the
+// copies of the classifier, and feed_forward allocates nothing.
+// Method: - the samples are the rows of the inputs: each row of weights is loaded once for the whole batch and
+//           multiplied with 4 samples at a time, on SIMD lanes
+//         - the sigmoid uses fastexp on SIMD lanes
+template<int Inputs, int Hiddens, int Outputs>
+struct Classifier
+{
+    // feed_forward goes through the samples by batches of this size, on the stack
+    static constexpr int MaxBatch = 16;
+
+    bool isLoaded() const
+    {
+        return weights != nullptr;
+    }
+
+    bool load(const NeuralNetwork &network)
+    {
+        if (!network.is_sigmoid_network({Inputs, Hiddens, Outputs}))
+            return false;
+
+        std::shared_ptr<Weights> loaded(new Weights);
+        copy(network.m_weights[0], loaded->hidden);
+        copy(network.m_bias[0], loaded->hiddenBias);
+        copy(network.m_weights[1], loaded->output);
+        copy(network.m_bias[1], loaded->outputBias);
+        weights = loaded;
+        return true;
+    }
+
+    // load the file written by NeuralNetwork::serialize
+    bool load(const char *path)
+    {
+        return load(NeuralNetwork().deserialize(path));
+    }
+
+    // outputs (count x Outputs) of the samples of inputs (count x Inputs), both stored row by row
+    void feed_forward(const float *inputs, int count, float *outputs) const
+    {
+        alignas(64) float hiddens[MaxBatch * Hiddens];
+        for (int begin = 0; begin < count; begin += MaxBatch)
+        {
+            int batch = std::min(MaxBatch, count - begin);
+            dense<Inputs, Hiddens>(weights->hidden, weights->hiddenBias, inputs + begin * Inputs, batch, hiddens);
+            dense<Hiddens, Outputs>(weights->output, weights->outputBias, hiddens, batch, outputs + begin * Outputs);
+        }
+    }
+
+    // index and score of the best output of each sample of outputs (count x Outputs)
+    static void argmax(const float *outputs, int count, int *indices, float *scores)
+    {
+        for (int i = 0; i < count; ++i, outputs += Outputs)
+        {
+            indices[i] = 0;
+            for (int k = 1; k < Outputs; ++k)
+            {
+                if (outputs[k] > outputs[indices[i]])
+                    indices[i] = k;
+            }
+            scores[i] = outputs[indices[i]];
+        }
+    }
+
+private:
+    struct Weights
+    {
+        alignas(64) float hidden[Hiddens * Inputs];
+        alignas(64) float hiddenBias[Hiddens];
+        alignas(64) float output[Outputs * Hiddens];
+        alignas(64) float outputBias[Outputs];
+    };
+
+    std::shared_ptr<const Weights> weights;
+
+    static void copy(const cv::Mat &m, float *dst)
+    {
+        for (int r = 0; r < m.rows; ++r, dst += m.cols)
+            std::memcpy(dst, m.ptr<float>(r), m.cols * sizeof(float));
+    }
+
+    static float dot(const float *a, const float *b, int size)
+    {
+        float sum = 0;
+        for (int k = 0; k < size; ++k)
+            sum += a[k] * b[k];
+        return sum;
+    }
+
+    // out[s][o] = sigmoid(bias[o] + weights[o] . in[s]) for the count samples of in
+    template<int In, int Out>
+    static void dense(const float *weights, const float *bias, const float *in, int count, float *out)
+    {
+        for (int o = 0; o < Out; ++o)
+        {
+            const float *row = weights + o * In;
+            int s = 0;
+#if CV_SIMD
+            using namespace cv;
+            constexpr int lanes = v_float32::nlanes;
+            constexpr int vectorized = In - In % lanes;
+            for (; s + 4 <= count; s += 4)
+            {
+                const float *in0 = in + s * In, *in1 = in0 + In, *in2 = in1 + In, *in3 = in2 + In;
+                v_float32 sum0 = vx_setzero_f32(), sum1 = vx_setzero_f32(), sum2 = vx_setzero_f32(), sum3 = vx_setzero_f32();
+                for (int k = 0; k < vectorized; k += lanes)
+                {
+                    v_float32 w = vx_load(row + k);
+                    sum0 = v_fma(w, vx_load(in0 + k), sum0);
+                    sum1 = v_fma(w, vx_load(in1 + k), sum1);
+                    sum2 = v_fma(w, vx_load(in2 + k), sum2);
+                    sum3 = v_fma(w, vx_load(in3 + k), sum3);
+                }
+                out[s * Out + o] = bias[o] + v_reduce_sum(sum0) + dot(row + vectorized, in0 + vectorized, In - vectorized);
+                out[(s + 1) * Out + o] = bias[o] + v_reduce_sum(sum1) + dot(row + vectorized, in1 + vectorized, In - vectorized);
+                out[(s + 2) * Out + o] = bias[o] + v_reduce_sum(sum2) + dot(row + vectorized, in2 + vectorized, In - vectorized);
+                out[(s + 3) * Out + o] = bias[o] + v_reduce_sum(sum3) + dot(row + vectorized, in3 + vectorized, In - vectorized);
+            }
+            for (; s < count; ++s)
+            {
+                const float *in0 = in + s * In;
+                v_float32 sum0 = vx_setzero_f32();
+                for (int k = 0; k < vectorized; k += lanes)
+                    sum0 = v_fma(vx_load(row + k), vx_load(in0 + k), sum0);
+                out[s * Out + o] = bias[o] + v_reduce_sum(sum0) + dot(row + vectorized, in0 + vectorized, In - vectorized);
+            }
+#endif
+            for (; s < count; ++s)
+                out[s * Out + o] = bias[o] + dot(row, in + s * In, In);
+        }
+        fastexp::sigmoid(out, count * Out);
+    }
+};
+
+// the letter classifier of neuralNetwork.bin: 28x28 characters, 128 hiddens, 26 letters
+using LetterClassifier = Classifier<28 * 28, 128, 26>;
+
+#endif //DEBOGGLER_CLASSIFIER_H
@@ -0,0 +1,57 @@
+#ifndef DEBOGGLER_DATASET_H
+#define DEBOGGLER_DATASET_H
+
+#include <algorithm>
+#include <filesystem>
+#include <random>       // std::default_random_engine
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgcodecs.hpp>
+
+#include "neuralnetwork.h"
+
+// a character written by the deboggler in output/, its letter being the first one of its file name
+struct Data : public TrainingData
+{
+    char targetChar;
+    std::string path;
+
+    explicit Data(const std::string &path, int nbOutputs)
+            : TrainingData(cv::imread(path, cv::IMREAD_GRAYSCALE), cv::Mat::zeros(nbOutputs, 1, CV_32FC1))
+              , targetChar(std::filesystem::path(path).filename().string()[0])
+              , path(path)
+    {
+        inputs = inputs.reshape(1, inputs.cols * inputs.rows);
+        inputs.convertTo(inputs, CV_32FC1, 1.0f / 255.0f);
+
+        int targetIndex = static_cast<int>(targetChar) - 'A';
+        targets.at<float>(0, targetIndex) = 1.0f;
+    }
+};
+
+inline size_t readAllImages(const char *path, std::vector<cv::String> &filepathes, std::vector<Data> &data, int nbOutputs)
+{
+    filepathes.clear();
+    data.clear();
+
+    cv::glob(path, filepathes, true);
+    size_t count = filepathes.size();
+    data.reserve(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        data.push_back(Data(filepathes[i], nbOutputs));
+    }
+    return count;
+}
+
+// shuffle data with seed and move its first tenth to the returned test split: the same seed gives the same split
+inline std::vector<Data> splitTestData(std::vector<Data> &data, unsigned seed)
+{
+    std::shuffle(data.begin(), data.end(), std::default_random_engine(seed));
+    auto end = data.begin() + data.size() / 10;
+    std::vector<Data> test(data.begin(), end);
+    data.erase(data.begin(), end);
+    return test;
+}
+
+#endif //DEBOGGLER_DATASET_H
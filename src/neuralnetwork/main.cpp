@@ -2,69 +2,52 @@
 
 #include <random>       // std::default_random_engine
 #include <chrono>       // std::chrono::system_clock
+#include <thread>
 
 #include <opencv2/core/core.hpp>
 #include "../commons.h"
 
 #include "perceptron.h"
 #include "neuralnetwork.h"
+#include "dataset.h"
 
 
-struct Data : public TrainingData
-{
-    char targetChar;
-    std::string path;
-
-    explicit Data(const std::string &path, int nbOutputs)
-            : TrainingData(cv::imread(path, cv::IMREAD_GRAYSCALE), cv::Mat::zeros(nbOutputs, 1, CV_32FC1))
-              , targetChar(std::filesystem::path(path).filename().string()[0])
-              , path(path)
-    {
-        inputs = inputs.reshape(1, inputs.cols * inputs.rows);
-        inputs.convertTo(inputs, CV_32FC1, 1.0f / 255.0f);
-
-        int targetIndex = static_cast<int>(targetChar) - 'A';
-        targets.at<float>(0, targetIndex) = 1.0f;
-    }
-};
-
 void evaluate(int nbOutputs, const NeuralNetwork &neuralNetwork, const std::vector<Data> &test);
 
-size_t readAllImages(const char *path, std::vector<cv::String> &filepathes, std::vector<Data> &data, int nbOutputs)
-{
-    filepathes.clear();
-    data.clear();
-
-    cv::glob(path, filepathes, true);
-    size_t count = filepathes.size();
-    data.reserve(count);
-    for (size_t i = 0; i < count; i++)
-    {
-        data.push_back(Data(filepathes[i], nbOutputs));
-    }
-    return count;
-}
-
 int main(int argc, const char *argv[]) {
     constexpr int nbOutputs = 26;
     constexpr const char* serializationPath = "../neuralNetwork.bin";
-    unsigned seed = std::chrono::system_clock::now().time_since_epoch().count();
+    constexpr int epochs = 1000;
+    // the seed of the test split and of the shuffles of the training, given to reproduce them (quantizer uses the same
+    // split for a given seed)
+    unsigned seed = argc > 1 ? unsigned(std::stoul(argv[1])) : unsigned(std::chrono::system_clock::now().time_since_epoch().count());
+    cout << "Seed: " << seed << endl;
+    // the threads the mini-batches are split across
+    unsigned threadCount = argc > 2 ? unsigned(std::stoul(argv[2])) : std::max(1u, std::thread::hardware_concurrency());
 
     std::vector<Data> training;
     std::vector<cv::String> filepathes;
     size_t count = readAllImages("../output/*.jpg", filepathes, training, nbOutputs);
     int nbInputs = training[0].inputs.rows;
-    auto neuralNetwork = std::filesystem::exists(serializationPath) ? NeuralNetwork().deserialize(serializationPath) : NeuralNetwork(nbInputs, 128, nbOutputs);
-    std::shuffle (training.begin(), training.end(), std::default_random_engine(seed));
-    auto test = std::vector<Data>(training.begin(), training.begin() + count / 10);
-    for (int i = 0; i < test.size(); ++i) {
-        training.pop_back();
+    // the topology of a new network (see NeuralNetwork::topology), when there is none to continue
+    std::string topology = argc > 3 ? argv[3] : std::to_string(nbInputs) + "-128-" + std::to_string(nbOutputs);
+    auto neuralNetwork = std::filesystem::exists(serializationPath) ? NeuralNetwork().deserialize(serializationPath) : NeuralNetwork::from_topology(topology);
+    if (neuralNetwork.layer_count() == 0)
+    {
+        cout << "Unexpected topology " << topology << endl;
+        return 1;
     }
+    cout << "Topology: " << neuralNetwork.topology() << endl;
+    auto test = splitTestData(training, seed);
 
     while (true)
     {
         evaluate(nbOutputs, neuralNetwork, test);
-        neuralNetwork.train(training, 1000, 100, 0.01f);
+        auto start = std::chrono::steady_clock::now();
+        neuralNetwork.train(training, epochs, 100, 0.01f, threadCount, seed);
+        auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        cout << "Training: " << elapsed / epochs << " ms per epoch (" << training.size() << " samples, "
+             << int(1000.0 * double(training.size()) * epochs / elapsed) << " samples/s on " << threadCount << " threads)" << endl;
         neuralNetwork.serialize(serializationPath);
     }
 }
@@ -5,13 +5,19 @@
 #ifndef DEBOGGLER_NEURALNETWORK_H
 #define DEBOGGLER_NEURALNETWORK_H
 
+#include <cctype>
+#include <chrono>
 #include <iostream>
 #include <fstream>
 #include <random>       // std::default_random_engine
+#include <string>
+#include <vector>
 
 #include <opencv2/core/core.hpp>
+#include <opencv2/core/hal/intrin.hpp>
 
 #include "serialization.h"
+#include "../solutioner/work_stealing_pool.h"
 
 template<typename UnaryFunc, typename Mat>
 Mat matmap(Mat &&input, UnaryFunc func)
@@ -41,6 +47,35 @@ float dsigmoid(float sigmoid)
     return sigmoid * (1.0f - sigmoid);
 }
 
+// the activation of a layer, saved with the topology (see NeuralNetwork::serialize)
+enum class Activation
+{
+    Sigmoid = 0,
+    Tanh = 1,
+    ReLU = 2,
+};
+
+inline const char *activation_name(Activation activation)
+{
+    switch (activation)
+    {
+        case Activation::Tanh: return "tanh";
+        case Activation::ReLU: return "relu";
+        default: return "sigmoid";
+    }
+}
+
+// the derivative of the activation, written from its output y (as dsigmoid)
+inline float derivative(Activation activation, float y)
+{
+    switch (activation)
+    {
+        case Activation::Tanh: return 1.0f - y * y;
+        case Activation::ReLU: return y > 0.0f ? 1.0f : 0.0f;
+        default: return dsigmoid(y);
+    }
+}
+
 struct TrainingData
 {
     cv::Mat inputs;
@@ -50,53 +85,288 @@ struct TrainingData
     {}
 };
 
+// Dense layers, from the inputs to the outputs: layer l computes activation(m_weights[l] * x + m_bias[l]) of the
+// outputs x of layer l - 1 (the inputs for the first one).
 struct NeuralNetwork
 {
-    cv::Mat m_weights[2];
-    cv::Mat m_bias[2];
+    std::vector<cv::Mat> m_weights;
+    std::vector<cv::Mat> m_bias;
+    std::vector<Activation> m_activations;
 
     NeuralNetwork() = default;
 
     NeuralNetwork(int nbInputs, int nbHiddens, int nbOutputs)
+            : NeuralNetwork({nbInputs, nbHiddens, nbOutputs}, {Activation::Sigmoid, Activation::Sigmoid})
+    {}
+
+    // sizes: the inputs then the outputs of each layer, activations: one per layer
+    // the sigmoid layers start uniform in [-1, 1], the other ones are scaled on their inputs (Xavier for tanh, He for
+    // ReLU) with no bias
+    NeuralNetwork(const std::vector<int> &sizes, const std::vector<Activation> &activations)
     {
-        m_weights[0] = cv::Mat::zeros(nbHiddens, nbInputs, CV_32FC1);
-        cv::randu(m_weights[0], -1.0f, 1.0f);
-        m_bias[0] = cv::Mat::zeros(nbHiddens, 1, CV_32FC1);
-        cv::randu(m_bias[0], -1.0f, 1.0f);
+        for (size_t l = 0; l + 1 < sizes.size(); ++l)
+        {
+            auto activation = l < activations.size() ? activations[l] : Activation::Sigmoid;
+            cv::Mat weights = cv::Mat::zeros(sizes[l + 1], sizes[l], CV_32FC1);
+            cv::Mat bias = cv::Mat::zeros(sizes[l + 1], 1, CV_32FC1);
+            if (activation == Activation::Sigmoid)
+            {
+                cv::randu(weights, -1.0f, 1.0f);
+                cv::randu(bias, -1.0f, 1.0f);
+            } else
+            {
+                float limit = std::sqrt(activation == Activation::ReLU ? 6.0f / float(sizes[l]) : 6.0f / float(sizes[l] + sizes[l + 1]));
+                cv::randu(weights, -limit, limit);
+            }
+            m_weights.push_back(weights);
+            m_bias.push_back(bias);
+            m_activations.push_back(activation);
+        }
+    }
 
-        m_weights[1] = cv::Mat::zeros(nbOutputs, nbHiddens, CV_32FC1);
-        cv::randu(m_weights[1], -1.0f, 1.0f);
-        m_bias[1] = cv::Mat::zeros(nbOutputs, 1, CV_32FC1);
-        cv::randu(m_bias[1], -1.0f, 1.0f);
+    // a network of the given topology (see topology()), empty when it can't be read
+    static NeuralNetwork from_topology(const std::string &topology)
+    {
+        std::vector<int> sizes;
+        std::vector<Activation> activations;
+        size_t begin = 0;
+        while (begin <= topology.size())
+        {
+            size_t end = std::min(topology.find('-', begin), topology.size());
+            std::string layer = topology.substr(begin, end - begin);
+            size_t digits = 0;
+            while (digits < layer.size() && std::isdigit((unsigned char) layer[digits]))
+                digits++;
+            std::string name = layer.substr(digits);
+            if (digits == 0 || (sizes.empty() && !name.empty()))
+                return {};
+            sizes.push_back(std::stoi(layer.substr(0, digits)));
+            if (sizes.size() > 1)
+            {
+                if (name.empty() || name == "sigmoid")
+                    activations.push_back(Activation::Sigmoid);
+                else if (name == "tanh")
+                    activations.push_back(Activation::Tanh);
+                else if (name == "relu")
+                    activations.push_back(Activation::ReLU);
+                else
+                    return {};
+            }
+            begin = end + 1;
+        }
+        return sizes.size() < 2 ? NeuralNetwork() : NeuralNetwork(sizes, activations);
     }
 
-    [[nodiscard]] cv::Mat feed_forward_to_hiddens(const cv::Mat &inputs) const
+    // the sizes of the inputs and of the layers separated by '-', each followed by the activation of the layer but
+    // sigmoid, e.g. "784-128-26" or "784-64relu-26"
+    [[nodiscard]] std::string topology() const
     {
-        return matmap(cv::Mat((m_weights[0] * inputs) + m_bias[0]), sigmoid);
+        if (m_weights.empty())
+            return "";
+        std::string topology = std::to_string(m_weights[0].cols);
+        for (size_t l = 0; l < m_weights.size(); ++l)
+        {
+            topology += "-" + std::to_string(m_weights[l].rows);
+            if (m_activations[l] != Activation::Sigmoid)
+                topology += activation_name(m_activations[l]);
+        }
+        return topology;
     }
 
-    [[nodiscard]] cv::Mat feed_forward_to_outputs(const cv::Mat &hiddens) const
+    [[nodiscard]] int layer_count() const
     {
-        return matmap(cv::Mat((m_weights[1] * hiddens) + m_bias[1]), sigmoid);
+        return int(m_weights.size());
+    }
+
+    // true for sigmoid layers of these sizes (the inputs then the outputs of each layer)
+    [[nodiscard]] bool is_sigmoid_network(const std::vector<int> &sizes) const
+    {
+        if (sizes.size() != m_weights.size() + 1)
+            return false;
+        for (int l = 0; l < layer_count(); ++l)
+        {
+            const cv::Mat &weights = m_weights[l], &bias = m_bias[l];
+            if (m_activations[l] != Activation::Sigmoid || weights.type() != CV_32FC1 || bias.type() != CV_32FC1
+                || weights.cols != sizes[l] || weights.rows != sizes[l + 1] || bias.rows != sizes[l + 1] || bias.cols != 1)
+                return false;
+        }
+        return true;
+    }
+
+    // the weights and biases of all the layers
+    [[nodiscard]] size_t parameter_count() const
+    {
+        size_t count = 0;
+        for (int l = 0; l < layer_count(); ++l)
+            count += m_weights[l].total() + m_bias[l].total();
+        return count;
+    }
+
+    // the outputs of layer l for the inputs x (a column)
+    [[nodiscard]] cv::Mat feed_forward_layer(int l, const cv::Mat &x) const
+    {
+        cv::Mat outputs = m_weights[l] * x;
+        add_bias_and_activate(outputs, m_bias[l], m_activations[l]);
+        return outputs;
     }
 
     [[nodiscard]] cv::Mat feed_forward(const cv::Mat &inputs) const
     {
-        return feed_forward_to_outputs(feed_forward_to_hiddens(inputs));
+        cv::Mat outputs = inputs;
+        for (int l = 0; l < layer_count(); ++l)
+            outputs = feed_forward_layer(l, outputs);
+        return outputs;
     }
 
-    template<class TData>
-    float train(std::vector<TData> &trainingData, int epochs, int batchSize, float learningRate = 0.05f)
+    // feed_forward of a batch, into the outputs of each layer (layers.back() being the outputs of the network): each
+    // column of inputs (nbInputs x batch) is one sample and gets its outputs in the same column of each layer. One GEMM
+    // per layer for the whole batch, nothing is allocated when layers already have the right sizes.
+    void feed_forward(const cv::Mat &inputs, std::vector<cv::Mat> &layers) const
     {
-        static unsigned seed = std::chrono::system_clock::now().time_since_epoch().count();
+        layers.resize(m_weights.size());
+        for (int l = 0; l < layer_count(); ++l)
+        {
+            cv::gemm(m_weights[l], l == 0 ? inputs : layers[l - 1], 1.0, cv::noArray(), 0.0, layers[l]);
+            add_bias_and_activate(layers[l], m_bias[l], m_activations[l]);
+        }
+    }
+
+    // index and score of the best output of each column of outputs (nbOutputs x batch)
+    static void argmax_columns(const cv::Mat &outputs, int *indices, float *scores)
+    {
+        for (int c = 0; c < outputs.cols; ++c)
+        {
+            indices[c] = 0;
+            scores[c] = outputs.at<float>(0, c);
+        }
+        for (int k = 1; k < outputs.rows; ++k)
+        {
+            const float *row = outputs.ptr<float>(k);
+            int c = 0;
+#if CV_SIMD
+            const int lanes = cv::v_float32::nlanes;
+            for (; c <= outputs.cols - lanes; c += lanes)
+            {
+                cv::v_float32 current = cv::vx_load(row + c), best = cv::vx_load(scores + c);
+                cv::v_float32 better = current > best;
+                cv::v_store(scores + c, cv::v_select(better, current, best));
+                cv::v_store(indices + c, cv::v_select(cv::v_reinterpret_as_s32(better), cv::vx_setall_s32(k), cv::vx_load(indices + c)));
+            }
+#endif
+            for (; c < outputs.cols; ++c)
+            {
+                if (row[c] > scores[c])
+                {
+                    scores[c] = row[c];
+                    indices[c] = k;
+                }
+            }
+        }
+    }
 
-        cv::Mat nabla_weights[2];
-        cv::Mat nabla_bias[2];
-        for (int i = 0; i < 2; ++i)
+    // m = activation(m + bias), the bias (a column) being added to every column of m
+    static void add_bias_and_activate(cv::Mat &m, const cv::Mat &bias, Activation activation = Activation::Sigmoid)
+    {
+        switch (activation)
         {
-            nabla_weights[i] = cv::Mat::zeros(m_weights[i].rows, m_weights[i].cols, m_weights[i].type());
-            nabla_bias[i] = cv::Mat::zeros(m_bias[i].rows, m_bias[i].cols, m_bias[i].type());
+            case Activation::Tanh: return add_bias_and_apply(m, bias, [](float x) { return std::tanh(x); });
+            case Activation::ReLU: return add_bias_and_apply(m, bias, [](float x) { return std::max(x, 0.0f); });
+            default: return add_bias_and_apply(m, bias, sigmoid);
         }
+    }
+
+    template<typename Function>
+    static void add_bias_and_apply(cv::Mat &m, const cv::Mat &bias, Function function)
+    {
+        for (int r = 0; r < m.rows; ++r)
+        {
+            auto row = m.ptr<float>(r);
+            const float b = bias.at<float>(r, 0);
+            for (int c = 0; c < m.cols; ++c)
+                row[c] = function(row[c] + b);
+        }
+    }
+
+    // buffers of train for batches of up to batchSize samples, allocated once: the samples are the rows of inputs and
+    // the columns of the other matrices (one per layer, as the weights)
+    struct Batch
+    {
+        cv::Mat inputs, targets;
+        std::vector<cv::Mat> outputs, errors, gradients;
+        std::vector<cv::Mat> nabla_weights;
+        std::vector<cv::Mat> nabla_bias;
+
+        Batch(const NeuralNetwork &network, int batchSize)
+                : inputs(batchSize, network.m_weights.front().cols, CV_32FC1)
+                  , targets(network.m_weights.back().rows, batchSize, CV_32FC1)
+        {
+            for (int l = 0; l < network.layer_count(); ++l)
+            {
+                int rows = network.m_weights[l].rows;
+                outputs.emplace_back(rows, batchSize, CV_32FC1);
+                errors.emplace_back(rows, batchSize, CV_32FC1);
+                gradients.emplace_back(rows, batchSize, CV_32FC1);
+                nabla_weights.push_back(cv::Mat::zeros(rows, network.m_weights[l].cols, CV_32FC1));
+                nabla_bias.push_back(cv::Mat::zeros(rows, 1, CV_32FC1));
+            }
+        }
+
+        // no sample: nothing to add to the weights, returns its error
+        float clear()
+        {
+            for (size_t l = 0; l < nabla_weights.size(); ++l)
+            {
+                nabla_weights[l] = 0.0f;
+                nabla_bias[l] = 0.0f;
+            }
+            return 0.0f;
+        }
+
+        // copy the samples [begin, end) in the first columns (rows of inputs)
+        template<class Iterator>
+        int set(Iterator begin, Iterator end)
+        {
+            int count = 0;
+            for (; begin != end; ++begin, ++count)
+            {
+                cv::Mat row = inputs.row(count);
+                begin->inputs.reshape(1, 1).copyTo(row);
+                for (int r = 0; r < targets.rows; ++r)
+                    targets.at<float>(r, count) = begin->targets.template at<float>(r, 0);
+            }
+            return count;
+        }
+    };
+
+    // the seed of the shuffles of train when none is given: a new one for each run of the program
+    static unsigned default_seed()
+    {
+        static unsigned seed = std::chrono::system_clock::now().time_since_epoch().count();
+        return seed;
+    }
+
+    // Method: - each mini-batch is split into threadCount contiguous shards, backpropagated on the threads of a
+    //           WorkStealingPool, each into its own Batch (its own nabla_weights and nabla_bias). The threads are
+    //           started once for the whole training and wait between the two runs of each mini-batch
+    //         - the reduction is lock-free: the rows of the weights are split between the threads, each row summing
+    //           the nablas of the shards in the order of the shards before updating the weights
+    //         - the weights only depend on seed and threadCount, not on the scheduling of the threads
+    template<class TData>
+    float train(std::vector<TData> &trainingData, int epochs, int batchSize, float learningRate = 0.05f,
+                unsigned threadCount = 1, unsigned seed = default_seed())
+    {
+        WorkStealingPool pool(std::min(threadCount, unsigned(batchSize)));
+        const int shardCount = int(pool.threadCount);
+        // the rows of all the layers, one after the other, for the reduction
+        std::vector<std::pair<int, int>> rows;
+        for (int l = 0; l < layer_count(); ++l)
+            for (int r = 0; r < m_weights[l].rows; ++r)
+                rows.emplace_back(l, r);
+        std::vector<Batch> shards;
+        shards.reserve(shardCount);
+        for (int s = 0; s < shardCount; ++s)
+            shards.emplace_back(*this, (batchSize + shardCount - 1) / shardCount);
+        std::vector<float> errors(shardCount);
 
         float error = 0.0;
         int totalCount = 0;
@@ -104,26 +374,37 @@ struct NeuralNetwork
         {
             std::shuffle(trainingData.begin(), trainingData.end(), std::default_random_engine(seed));
 
-            int count = 0;
             auto batchBegin = trainingData.begin();
             while (batchBegin != trainingData.end())
             {
                 auto batchEnd = std::distance(batchBegin, trainingData.end()) > batchSize ? batchBegin + batchSize : trainingData.end();
-                for (;batchBegin != batchEnd; batchBegin++) {
-                    error += backpropagate(*batchBegin, nabla_weights, nabla_bias, learningRate);
-                    count++;
-                }
+                int count = int(std::distance(batchBegin, batchEnd));
+                pool.run(shardCount, [&](size_t shard, unsigned) {
+                    auto &batch = shards[shard];
+                    int samples = batch.set(batchBegin + count * int(shard) / shardCount,
+                                            batchBegin + count * int(shard + 1) / shardCount);
+                    errors[shard] = samples > 0 ? backpropagate(batch, samples, learningRate) : batch.clear();
+                });
 
                 float inv_factor = 1.0f / float(count);
-                for (int k = 0; k < 2; ++k)
-                {
-                    m_weights[k] += nabla_weights[k] * inv_factor;
-                    nabla_weights[k] = 0;
-                    m_bias[k] += nabla_bias[k] * inv_factor;
-                    nabla_bias[k] = 0;
-                }
+                pool.run(rows.size(), [&](size_t row, unsigned) {
+                    auto [k, r] = rows[row];
+                    cv::Mat nabla_weights = shards[0].nabla_weights[k].row(r);
+                    float &nabla_bias = shards[0].nabla_bias[k].at<float>(r, 0);
+                    for (size_t s = 1; s < shards.size(); ++s)
+                    {
+                        nabla_weights += shards[s].nabla_weights[k].row(r);
+                        nabla_bias += shards[s].nabla_bias[k].at<float>(r, 0);
+                    }
+                    cv::Mat weights = m_weights[k].row(r);
+                    cv::scaleAdd(nabla_weights, inv_factor, weights, weights);
+                    m_bias[k].at<float>(r, 0) += nabla_bias * inv_factor;
+                });
+
+                for (float shardError: errors)
+                    error += shardError;
                 totalCount += count;
-                count = 0;
+                batchBegin = batchEnd;
             }
 
 //            std::cout << "Epoch << " << i << ": " << (error / float (totalCount)) << std::endl;
@@ -132,46 +413,131 @@ struct NeuralNetwork
         return error / float (totalCount);
     }
 
-    float backpropagate(const TrainingData &trainingData, cv::Mat nabla_weights[], cv::Mat nabla_bias[], float learningRate) const
+    // backpropagate of the first count samples of batch at once, into batch.nabla_weights and batch.nabla_bias (their
+    // sums over the samples): one GEMM per layer forward, two per layer backward, the transposes being GEMM flags.
+    // The error of a layer is the one of the next layer through its weights (m_weights[l + 1]^T * errors[l + 1]).
+    float backpropagate(Batch &batch, int count, float learningRate) const
+    {
+        const int last = layer_count() - 1;
+        cv::Mat inputs = batch.inputs.rowRange(0, count), targets = batch.targets.colRange(0, count);
+        for (int l = 0; l <= last; ++l)
+        {
+            cv::Mat outputs = batch.outputs[l].colRange(0, count);
+            if (l == 0)
+                cv::gemm(m_weights[0], inputs, 1.0, cv::noArray(), 0.0, outputs, cv::GEMM_2_T);
+            else
+                cv::gemm(m_weights[l], batch.outputs[l - 1].colRange(0, count), 1.0, cv::noArray(), 0.0, outputs);
+            add_bias_and_activate(outputs, m_bias[l], m_activations[l]);
+        }
+
+        cv::Mat errors = batch.errors[last].colRange(0, count);
+        cv::subtract(targets, batch.outputs[last].colRange(0, count), errors);
+        for (int l = last; l >= 0; --l)
+        {
+            // lr * Errors * activation'(Outputs) * transpose(Inputs of the layer)
+            cv::Mat gradients = batch.gradients[l].colRange(0, count);
+            compute_gradients(batch.errors[l].colRange(0, count), batch.outputs[l].colRange(0, count), m_activations[l], learningRate, gradients);
+            if (l == 0)
+                cv::gemm(gradients, inputs, 1.0, cv::noArray(), 0.0, batch.nabla_weights[0]);
+            else
+                cv::gemm(gradients, batch.outputs[l - 1].colRange(0, count), 1.0, cv::noArray(), 0.0, batch.nabla_weights[l], cv::GEMM_2_T);
+            cv::reduce(gradients, batch.nabla_bias[l], 1, cv::REDUCE_SUM);
+
+            if (l > 0)
+            {
+                cv::Mat previousErrors = batch.errors[l - 1].colRange(0, count);
+                cv::gemm(m_weights[l], batch.errors[l].colRange(0, count), 1.0, cv::noArray(), 0.0, previousErrors, cv::GEMM_1_T);
+            }
+        }
+
+        // the sum of the norms of the errors of the samples
+        float error = 0.0f;
+        for (int c = 0; c < count; ++c)
+        {
+            float squares = 0.0f;
+            for (int r = 0; r < errors.rows; ++r)
+                squares += errors.at<float>(r, c) * errors.at<float>(r, c);
+            error += std::sqrt(squares);
+        }
+        return error;
+    }
+
+    // gradients = learningRate * errors * activation'(outputs), the derivative being written from the outputs
+    static void compute_gradients(const cv::Mat &errors, const cv::Mat &outputs, Activation activation, float learningRate, cv::Mat &gradients)
     {
-        auto hiddens = feed_forward_to_hiddens(trainingData.inputs);
-        auto outputs = feed_forward_to_outputs(hiddens);
+        for (int r = 0; r < errors.rows; ++r)
+        {
+            const float *error = errors.ptr<float>(r), *output = outputs.ptr<float>(r);
+            float *gradient = gradients.ptr<float>(r);
+            for (int c = 0; c < errors.cols; ++c)
+                gradient[c] = learningRate * error[c] * derivative(activation, output[c]);
+        }
+    }
 
-        // Outputs to Hiddens backpropagation
-        auto errorOutputToHidden = trainingData.targets - outputs;
-        // calculate deltas outputs->hiddens: lr * Errors * (Outputs*(1-Outputs)) * transpose(Hiddens)
-        auto gradientOutputToHidden = learningRate * errorOutputToHidden.mul(matmap(outputs.clone(), dsigmoid));
-        auto deltaOutputToHidden = gradientOutputToHidden * hiddens.t();
-        nabla_weights[1] += deltaOutputToHidden;
-        nabla_bias[1] += gradientOutputToHidden;
+    // one sample at a time, the reference of backpropagate of a batch
+    float backpropagate(const TrainingData &trainingData, std::vector<cv::Mat> &nabla_weights, std::vector<cv::Mat> &nabla_bias, float learningRate) const
+    {
+        std::vector<cv::Mat> outputs;
+        for (int l = 0; l < layer_count(); ++l)
+            outputs.push_back(feed_forward_layer(l, l == 0 ? trainingData.inputs : outputs[l - 1]));
 
-        // Hiddens to Inputs backpropagation
-        cv::Mat errorHiddenToInput = m_weights[1].t() * errorOutputToHidden;
-        // calculate deltas hiddens->inputs: lr * Errors * (Hiddens*(1-Hiddens)) * transpose(Inputs)
-        auto gradientHiddenToInput = learningRate * errorHiddenToInput.mul(matmap(hiddens.clone(), dsigmoid));
-        auto deltaHiddenToInput = gradientHiddenToInput * trainingData.inputs.t();
-        nabla_weights[0] += deltaHiddenToInput;
-        nabla_bias[0] += gradientHiddenToInput;
-        return norm(errorOutputToHidden);
+        cv::Mat errors = trainingData.targets - outputs.back();
+        float error = float(norm(errors));
+        for (int l = layer_count() - 1; l >= 0; --l)
+        {
+            // calculate deltas: lr * Errors * activation'(Outputs) * transpose(Inputs of the layer)
+            cv::Mat gradients(errors.size(), CV_32FC1);
+            compute_gradients(errors, outputs[l], m_activations[l], learningRate, gradients);
+            nabla_weights[l] += gradients * (l == 0 ? trainingData.inputs : outputs[l - 1]).t();
+            nabla_bias[l] += gradients;
+            if (l > 0)
+                errors = m_weights[l].t() * errors;
+        }
+        return error;
     }
 
+    // the topology (one row per layer: inputs, outputs, activation), then the weights and the biases of the layers
     void serialize(const char *path) const
     {
         std::ofstream fs(path, std::ios::out | std::ios::binary);
-        matwrite(fs, m_weights[0]);
-        matwrite(fs, m_weights[1]);
-        matwrite(fs, m_bias[0]);
-        matwrite(fs, m_bias[1]);
+        cv::Mat topology(layer_count(), 3, CV_32SC1);
+        for (int l = 0; l < layer_count(); ++l)
+        {
+            topology.at<int>(l, 0) = m_weights[l].cols;
+            topology.at<int>(l, 1) = m_weights[l].rows;
+            topology.at<int>(l, 2) = int(m_activations[l]);
+        }
+        matwrite(fs, topology);
+        for (auto &weights: m_weights)
+            matwrite(fs, weights);
+        for (auto &bias: m_bias)
+            matwrite(fs, bias);
         fs.close();
     }
 
+    // the files written before the topology (two sigmoid layers: the weights then the biases) are read as well
     NeuralNetwork &deserialize(const char *path)
     {
         std::ifstream fs(path, std::ios::in | std::ios::binary);
-        m_weights[0] = matread(fs);
-        m_weights[1] = matread(fs);
-        m_bias[0] = matread(fs);
-        m_bias[1] = matread(fs);
+        cv::Mat first = matread(fs);
+        if (first.type() == CV_32SC1)
+        {
+            m_weights.resize(first.rows);
+            m_bias.resize(first.rows);
+            m_activations.resize(first.rows);
+            for (int l = 0; l < first.rows; ++l)
+            {
+                m_weights[l] = matread(fs);
+                m_activations[l] = Activation(first.at<int>(l, 2));
+            }
+            for (int l = 0; l < first.rows; ++l)
+                m_bias[l] = matread(fs);
+        } else
+        {
+            m_weights = {first, matread(fs)};
+            m_bias = {matread(fs), matread(fs)};
+            m_activations = {Activation::Sigmoid, Activation::Sigmoid};
+        }
         return *this;
     }
 };
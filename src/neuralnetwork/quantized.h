@@ -0,0 +1,228 @@
+#ifndef DEBOGGLER_QUANTIZED_H
+#define DEBOGGLER_QUANTIZED_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+
+#include <opencv2/core/hal/intrin.hpp>
+
+#include "neuralnetwork.h"
+#include "classifier.h"
+
+// Int8 version of Classifier: quantize() makes it from a NeuralNetwork and calibration samples, serialize() and load() use
+// its own file, about 4 times smaller than the one of NeuralNetwork::serialize.
+// Method: - the weights of a layer are w = weightScale * q, q in [-127, 127], weightScale = max(|w|) / 127
+//         - the inputs of a layer (pixels, hiddens) are in [0, 1]: x = inputScale * q, q in [0, 127], inputScale being
+//           calibrated on the largest input of the layer seen on the samples
+//         - the biases are int32, in the unit of the products (weightScale * inputScale), added to the accumulator
+//         - the dot products run on int8 lanes (v_dotprod_expand: 4 products summed in each int32 lane, 784 * 127 *
+//           127 fits easily), the accumulator is scaled back to float for the sigmoid
+template<int Inputs, int Hiddens, int Outputs>
+struct QuantizedClassifier
+{
+    // feed_forward goes through the samples by batches of this size, on the stack
+    static constexpr int MaxBatch = 16;
+
+    bool isLoaded() const
+    {
+        return weights != nullptr;
+    }
+
+    // quantize network, the scales of the inputs of its layers calibrated on samples (count x Inputs, row by row)
+    bool quantize(const NeuralNetwork &network, const float *samples, int count)
+    {
+        if (count <= 0 || !network.is_sigmoid_network({Inputs, Hiddens, Outputs}))
+            return false;
+
+        const cv::Mat &hiddenWeights = network.m_weights[0], &hiddenBias = network.m_bias[0];
+        // largest input of each layer, the hiddens being computed in double as the reference
+        float inputMaximum = 0, hiddenMaximum = 0;
+        for (int s = 0; s < count; ++s)
+        {
+            const float *sample = samples + s * Inputs;
+            for (int k = 0; k < Inputs; ++k)
+                inputMaximum = std::max(inputMaximum, sample[k]);
+            for (int o = 0; o < Hiddens; ++o)
+            {
+                const float *row = hiddenWeights.ptr<float>(o);
+                double sum = hiddenBias.at<float>(o, 0);
+                for (int k = 0; k < Inputs; ++k)
+                    sum += double(row[k]) * sample[k];
+                hiddenMaximum = std::max(hiddenMaximum, float(1.0 / (1.0 + std::exp(-sum))));
+            }
+        }
+
+        std::shared_ptr<Weights> quantized(new Weights);
+        quantizeLayer(network.m_weights[0], network.m_bias[0], inputMaximum, quantized->hidden);
+        quantizeLayer(network.m_weights[1], network.m_bias[1], hiddenMaximum, quantized->output);
+        weights = quantized;
+        return true;
+    }
+
+    // the scales (one row per layer: inputScale, weightScale), then the weights and the biases as NeuralNetwork does
+    void serialize(const char *path) const
+    {
+        std::ofstream fs(path, std::ios::out | std::ios::binary);
+        cv::Mat scales = (cv::Mat_<float>(2, 2) << weights->hidden.inputScale, weights->hidden.weightScale,
+                weights->output.inputScale, weights->output.weightScale);
+        matwrite(fs, scales);
+        matwrite(fs, cv::Mat(Hiddens, Inputs, CV_8SC1, (void *) weights->hidden.weights));
+        matwrite(fs, cv::Mat(Outputs, Hiddens, CV_8SC1, (void *) weights->output.weights));
+        matwrite(fs, cv::Mat(Hiddens, 1, CV_32SC1, (void *) weights->hidden.bias));
+        matwrite(fs, cv::Mat(Outputs, 1, CV_32SC1, (void *) weights->output.bias));
+        fs.close();
+    }
+
+    // load the file written by serialize
+    bool load(const char *path)
+    {
+        std::ifstream fs(path, std::ios::in | std::ios::binary);
+        if (!fs)
+            return false;
+        cv::Mat scales = matread(fs);
+        cv::Mat hiddenWeights = matread(fs), outputWeights = matread(fs);
+        cv::Mat hiddenBias = matread(fs), outputBias = matread(fs);
+        if (!fs || scales.type() != CV_32FC1 || scales.rows != 2 || scales.cols != 2
+            || !hasShape(hiddenWeights, Hiddens, Inputs, CV_8SC1) || !hasShape(outputWeights, Outputs, Hiddens, CV_8SC1)
+            || !hasShape(hiddenBias, Hiddens, 1, CV_32SC1) || !hasShape(outputBias, Outputs, 1, CV_32SC1))
+            return false;
+
+        std::shared_ptr<Weights> loaded(new Weights);
+        loaded->hidden.inputScale = scales.at<float>(0, 0);
+        loaded->hidden.weightScale = scales.at<float>(0, 1);
+        loaded->output.inputScale = scales.at<float>(1, 0);
+        loaded->output.weightScale = scales.at<float>(1, 1);
+        std::memcpy(loaded->hidden.weights, hiddenWeights.data, sizeof(loaded->hidden.weights));
+        std::memcpy(loaded->output.weights, outputWeights.data, sizeof(loaded->output.weights));
+        std::memcpy(loaded->hidden.bias, hiddenBias.data, sizeof(loaded->hidden.bias));
+        std::memcpy(loaded->output.bias, outputBias.data, sizeof(loaded->output.bias));
+        weights = loaded;
+        return true;
+    }
+
+    // outputs (count x Outputs) of the samples of inputs (count x Inputs), both stored row by row, as Classifier
+    void feed_forward(const float *inputs, int count, float *outputs) const
+    {
+        alignas(64) int8_t quantizedInputs[MaxBatch * Inputs];
+        alignas(64) float hiddens[MaxBatch * Hiddens];
+        alignas(64) int8_t quantizedHiddens[MaxBatch * Hiddens];
+        for (int begin = 0; begin < count; begin += MaxBatch)
+        {
+            int batch = std::min(MaxBatch, count - begin);
+            quantizeInputs(inputs + begin * Inputs, batch * Inputs, weights->hidden.inputScale, quantizedInputs);
+            dense(weights->hidden, quantizedInputs, batch, hiddens);
+            quantizeInputs(hiddens, batch * Hiddens, weights->output.inputScale, quantizedHiddens);
+            dense(weights->output, quantizedHiddens, batch, outputs + begin * Outputs);
+        }
+    }
+
+private:
+    template<int In, int Out>
+    struct Layer
+    {
+        float inputScale;
+        float weightScale;
+        alignas(64) int8_t weights[Out * In];
+        alignas(64) int32_t bias[Out];
+    };
+
+    struct Weights
+    {
+        Layer<Inputs, Hiddens> hidden;
+        Layer<Hiddens, Outputs> output;
+    };
+
+    std::shared_ptr<const Weights> weights;
+
+    static bool hasShape(const cv::Mat &m, int rows, int cols, int type)
+    {
+        return m.type() == type && m.rows == rows && m.cols == cols;
+    }
+
+    template<int In, int Out>
+    static void quantizeLayer(const cv::Mat &weights, const cv::Mat &bias, float inputMaximum, Layer<In, Out> &layer)
+    {
+        double weightMaximum = 0;
+        cv::minMaxLoc(cv::abs(weights), nullptr, &weightMaximum);
+        layer.inputScale = inputMaximum > 0 ? inputMaximum / 127.0f : 1.0f / 127.0f;
+        layer.weightScale = weightMaximum > 0 ? float(weightMaximum) / 127.0f : 1.0f / 127.0f;
+        for (int o = 0; o < Out; ++o)
+        {
+            const float *row = weights.ptr<float>(o);
+            for (int k = 0; k < In; ++k)
+                layer.weights[o * In + k] = int8_t(std::max(-127.0f, std::min(127.0f, std::nearbyint(row[k] / layer.weightScale))));
+            layer.bias[o] = int32_t(std::nearbyint(bias.at<float>(o, 0) / (layer.weightScale * layer.inputScale)));
+        }
+    }
+
+    // quantized[i] = round(values[i] / scale) in [0, 127]
+    static void quantizeInputs(const float *values, int size, float scale, int8_t *quantized)
+    {
+        const float inverse = 1.0f / scale;
+        for (int i = 0; i < size; ++i)
+            quantized[i] = int8_t(std::max(0.0f, std::min(127.0f, std::nearbyint(values[i] * inverse))));
+    }
+
+    static int32_t dot(const int8_t *a, const int8_t *b, int size)
+    {
+        int32_t sum = 0;
+        for (int k = 0; k < size; ++k)
+            sum += int32_t(a[k]) * b[k];
+        return sum;
+    }
+
+    // out[s][o] = sigmoid(scale * (bias[o] + weights[o] . in[s])) for the count samples of in
+    template<int In, int Out>
+    static void dense(const Layer<In, Out> &layer, const int8_t *in, int count, float *out)
+    {
+        const float scale = layer.weightScale * layer.inputScale;
+        for (int o = 0; o < Out; ++o)
+        {
+            const int8_t *row = layer.weights + o * In;
+            const int32_t bias = layer.bias[o];
+            int s = 0;
+#if CV_SIMD
+            using namespace cv;
+            constexpr int lanes = v_int8::nlanes;
+            constexpr int vectorized = In - In % lanes;
+            for (; s + 4 <= count; s += 4)
+            {
+                const int8_t *in0 = in + s * In, *in1 = in0 + In, *in2 = in1 + In, *in3 = in2 + In;
+                v_int32 sum0 = vx_setzero_s32(), sum1 = vx_setzero_s32(), sum2 = vx_setzero_s32(), sum3 = vx_setzero_s32();
+                for (int k = 0; k < vectorized; k += lanes)
+                {
+                    v_int8 w = vx_load(row + k);
+                    sum0 = v_dotprod_expand(w, vx_load(in0 + k), sum0);
+                    sum1 = v_dotprod_expand(w, vx_load(in1 + k), sum1);
+                    sum2 = v_dotprod_expand(w, vx_load(in2 + k), sum2);
+                    sum3 = v_dotprod_expand(w, vx_load(in3 + k), sum3);
+                }
+                out[s * Out + o] = scale * float(bias + v_reduce_sum(sum0) + dot(row + vectorized, in0 + vectorized, In - vectorized));
+                out[(s + 1) * Out + o] = scale * float(bias + v_reduce_sum(sum1) + dot(row + vectorized, in1 + vectorized, In - vectorized));
+                out[(s + 2) * Out + o] = scale * float(bias + v_reduce_sum(sum2) + dot(row + vectorized, in2 + vectorized, In - vectorized));
+                out[(s + 3) * Out + o] = scale * float(bias + v_reduce_sum(sum3) + dot(row + vectorized, in3 + vectorized, In - vectorized));
+            }
+            for (; s < count; ++s)
+            {
+                const int8_t *in0 = in + s * In;
+                v_int32 sum0 = vx_setzero_s32();
+                for (int k = 0; k < vectorized; k += lanes)
+                    sum0 = v_dotprod_expand(vx_load(row + k), vx_load(in0 + k), sum0);
+                out[s * Out + o] = scale * float(bias + v_reduce_sum(sum0) + dot(row + vectorized, in0 + vectorized, In - vectorized));
+            }
+#endif
+            for (; s < count; ++s)
+                out[s * Out + o] = scale * float(bias + dot(row, in + s * In, In));
+        }
+        fastexp::sigmoid(out, count * Out);
+    }
+};
+
+// the int8 version of LetterClassifier
+using QuantizedLetterClassifier = QuantizedClassifier<28 * 28, 128, 26>;
+
+#endif //DEBOGGLER_QUANTIZED_H
@@ -0,0 +1,140 @@
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+
+#include "neuralnetwork.h"
+#include "classifier.h"
+#include "quantized.h"
+#include "dataset.h"
+
+// Post-training quantization of neuralNetwork.bin into neuralNetwork.q8, for QuantizedLetterClassifier:
+// - the characters of output/ are split as neuralnetworktest does for the given seed, the scales of the inputs of the
+//   layers are calibrated on the training part
+// - the float network (NeuralNetwork::feed_forward, as evaluate() does) and the int8 one are compared on the test part,
+//   printed as JSON: accuracy (best letter is the right one), score (the one of evaluate(): average best output of the
+//   right guesses), their deltas, the model sizes and the latency per board (16 characters)
+// usage: quantizer [seed] [model] [quantized model]
+
+constexpr int LetterCount = 16;
+constexpr int nbOutputs = 26;
+
+using Clock = std::chrono::steady_clock;
+
+struct Evaluation
+{
+    size_t correct = 0;
+    float score = 0.0f;
+
+    // the best letter of outputs
+    int add(const float *outputs, char targetChar)
+    {
+        int best = 0;
+        float bestScore = 0.0f;
+        LetterClassifier::argmax(outputs, 1, &best, &bestScore);
+        if ((char) ('A' + best) == targetChar)
+        {
+            correct++;
+            score += bestScore;
+        }
+        return best;
+    }
+};
+
+// the samples of data as rows of inputs
+cv::Mat toSamples(const std::vector<Data> &data)
+{
+    cv::Mat samples(int(data.size()), 28 * 28, CV_32FC1);
+    for (int i = 0; i < samples.rows; ++i)
+    {
+        cv::Mat sample = samples.row(i);
+        data[i].inputs.reshape(1, 1).copyTo(sample);
+    }
+    return samples;
+}
+
+template<typename Classifier>
+double microsecondsPerBoard(const Classifier &classifier, const cv::Mat &samples, cv::Mat &outputs)
+{
+    int boardCount = samples.rows / LetterCount;
+    auto start = Clock::now();
+    for (int board = 0; board < boardCount; ++board)
+    {
+        int first = board * LetterCount;
+        classifier.feed_forward(samples.ptr<float>(first), LetterCount, outputs.ptr<float>(first));
+    }
+    return std::chrono::duration<double, std::micro>(Clock::now() - start).count() / double(std::max(boardCount, 1));
+}
+
+int main(int argc, const char *argv[])
+{
+    unsigned seed = argc > 1 ? unsigned(std::stoul(argv[1])) : 0u;
+    const char *networkPath = argc > 2 ? argv[2] : "../neuralNetwork.bin";
+    const char *quantizedPath = argc > 3 ? argv[3] : "../neuralNetwork.q8";
+
+    NeuralNetwork neuralNetwork;
+    neuralNetwork.deserialize(networkPath);
+    LetterClassifier classifier;
+    if (!classifier.load(neuralNetwork))
+    {
+        std::cerr << "Could not load " << networkPath << " (a 784-128-26 network is expected)" << std::endl;
+        return 1;
+    }
+
+    std::vector<Data> training;
+    std::vector<cv::String> filepathes;
+    if (!std::filesystem::is_directory("../output")
+        || readAllImages("../output/*.jpg", filepathes, training, nbOutputs) < 10)
+    {
+        std::cerr << "The characters of output/ are needed for the calibration and the evaluation" << std::endl;
+        return 1;
+    }
+    auto test = splitTestData(training, seed);
+
+    cv::Mat calibration = toSamples(training);
+    QuantizedLetterClassifier quantized;
+    quantized.quantize(neuralNetwork, calibration.ptr<float>(0), calibration.rows);
+    quantized.serialize(quantizedPath);
+
+    // reloaded: the evaluation is the one of the file
+    QuantizedLetterClassifier loaded;
+    if (!loaded.load(quantizedPath))
+    {
+        std::cerr << "Could not read back " << quantizedPath << std::endl;
+        return 1;
+    }
+
+    cv::Mat samples = toSamples(test);
+    cv::Mat quantizedOutputs(samples.rows, nbOutputs, CV_32FC1), classifierOutputs(samples.rows, nbOutputs, CV_32FC1);
+    loaded.feed_forward(samples.ptr<float>(0), samples.rows, quantizedOutputs.ptr<float>(0));
+
+    Evaluation floatEvaluation, quantizedEvaluation;
+    size_t sameLetters = 0;
+    for (int i = 0; i < samples.rows; ++i)
+    {
+        cv::Mat guess = neuralNetwork.feed_forward(test[i].inputs);
+        int floatBest = floatEvaluation.add(guess.ptr<float>(0), test[i].targetChar);
+        int quantizedBest = quantizedEvaluation.add(quantizedOutputs.ptr<float>(i), test[i].targetChar);
+        sameLetters += floatBest == quantizedBest;
+    }
+
+    double classifierLatency = microsecondsPerBoard(classifier, samples, classifierOutputs);
+    double quantizedLatency = microsecondsPerBoard(loaded, samples, quantizedOutputs);
+
+    auto count = double(test.size());
+    double floatAccuracy = double(floatEvaluation.correct) / count, quantizedAccuracy = double(quantizedEvaluation.correct) / count;
+    double floatScore = floatEvaluation.score / count, quantizedScore = quantizedEvaluation.score / count;
+    std::cout << "{\n"
+              << "  \"seed\": " << seed << ",\n"
+              << "  \"calibration_samples\": " << training.size() << ",\n"
+              << "  \"test_samples\": " << test.size() << ",\n"
+              << "  \"accuracy\": {\"float\": " << floatAccuracy << ", \"int8\": " << quantizedAccuracy
+              << ", \"delta\": " << quantizedAccuracy - floatAccuracy << "},\n"
+              << "  \"score\": {\"float\": " << floatScore << ", \"int8\": " << quantizedScore
+              << ", \"delta\": " << quantizedScore - floatScore << "},\n"
+              << "  \"same_letters\": " << double(sameLetters) / count << ",\n"
+              << "  \"model_bytes\": {\"float\": " << std::filesystem::file_size(networkPath)
+              << ", \"int8\": " << std::filesystem::file_size(quantizedPath) << "},\n"
+              << "  \"latency_us_per_board\": {\"classifier\": " << classifierLatency << ", \"int8\": " << quantizedLatency << "}\n"
+              << "}" << std::endl;
+    return 0;
+}
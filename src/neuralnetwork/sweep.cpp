@@ -0,0 +1,126 @@
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <thread>
+
+#include "neuralnetwork.h"
+#include "dataset.h"
+
+// Trains a network of each topology (see NeuralNetwork::topology) on the characters of output/, split as
+// neuralnetworktest does for the given seed, and prints as JSON for each one: its parameters, the size of its file
+// (written to ../sweep/<topology>.bin), its accuracy on the test split (best letter is the right one) and its latency
+// per board (16 characters through the batched NeuralNetwork::feed_forward, the path of any topology on-device).
+// usage: topologysweep [epochs] [seed] [topology...]
+
+constexpr int nbOutputs = 26;
+constexpr int LetterCount = 16;
+constexpr int batchSize = 100;
+constexpr float learningRate = 0.01f;
+constexpr const char *sweepPath = "../sweep";
+
+using Clock = std::chrono::steady_clock;
+
+// the samples of data as columns of inputs
+cv::Mat toColumns(const std::vector<Data> &data)
+{
+    cv::Mat inputs(data.front().inputs.rows, int(data.size()), CV_32FC1);
+    for (int i = 0; i < inputs.cols; ++i)
+    {
+        cv::Mat column = inputs.col(i);
+        data[i].inputs.copyTo(column);
+    }
+    return inputs;
+}
+
+double accuracy(const NeuralNetwork &network, const cv::Mat &inputs, const std::vector<Data> &test)
+{
+    std::vector<cv::Mat> layers;
+    network.feed_forward(inputs, layers);
+    std::vector<int> indices(test.size());
+    std::vector<float> scores(test.size());
+    NeuralNetwork::argmax_columns(layers.back(), indices.data(), scores.data());
+
+    size_t correct = 0;
+    for (size_t i = 0; i < test.size(); ++i)
+        correct += (char) ('A' + indices[i]) == test[i].targetChar;
+    return double(correct) / double(test.size());
+}
+
+double microsecondsPerBoard(const NeuralNetwork &network, const cv::Mat &inputs)
+{
+    constexpr int boardCount = 500;
+    int boards = inputs.cols / LetterCount;
+    if (boards == 0)
+        return 0;
+    cv::Mat boardInputs(inputs.rows, LetterCount, CV_32FC1);
+    std::vector<cv::Mat> layers;
+    auto start = Clock::now();
+    for (int board = 0; board < boardCount; ++board)
+    {
+        int first = (board % boards) * LetterCount;
+        inputs.colRange(first, first + LetterCount).copyTo(boardInputs);
+        network.feed_forward(boardInputs, layers);
+    }
+    return std::chrono::duration<double, std::micro>(Clock::now() - start).count() / boardCount;
+}
+
+int main(int argc, const char *argv[])
+{
+    int epochs = argc > 1 ? std::atoi(argv[1]) : 100;
+    unsigned seed = argc > 2 ? unsigned(std::stoul(argv[2])) : 0u;
+    std::vector<std::string> topologies(argv + std::min(argc, 3), argv + argc);
+    if (topologies.empty())
+        topologies = {"784-16-26", "784-32-26", "784-64-26", "784-128-26", "784-64relu-26", "784-64tanh-26", "784-64-32-26"};
+
+    std::vector<Data> training;
+    std::vector<cv::String> filepathes;
+    if (!std::filesystem::is_directory("../output")
+        || readAllImages("../output/*.jpg", filepathes, training, nbOutputs) < 10)
+    {
+        std::cerr << "The characters of output/ are needed for the training and the evaluation" << std::endl;
+        return 1;
+    }
+    auto test = splitTestData(training, seed);
+    cv::Mat testInputs = toColumns(test);
+    std::filesystem::create_directories(sweepPath);
+    unsigned threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+    std::cout << "{\n"
+              << "  \"seed\": " << seed << ",\n"
+              << "  \"epochs\": " << epochs << ",\n"
+              << "  \"training_samples\": " << training.size() << ",\n"
+              << "  \"test_samples\": " << test.size() << ",\n"
+              << "  \"topologies\": [\n";
+    const char *separator = "";
+    for (size_t i = 0; i < topologies.size(); ++i)
+    {
+        cv::theRNG().state = seed;
+        auto network = NeuralNetwork::from_topology(topologies[i]);
+        if (network.layer_count() == 0 || network.m_weights.front().cols != testInputs.rows
+            || network.m_weights.back().rows != nbOutputs)
+        {
+            std::cerr << "Unexpected topology " << topologies[i] << " (" << testInputs.rows << " inputs and "
+                      << nbOutputs << " outputs are expected)" << std::endl;
+            continue;
+        }
+
+        auto shuffled = training;
+        auto start = Clock::now();
+        network.train(shuffled, epochs, batchSize, learningRate, threadCount, seed);
+        double trainingSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+        std::string path = std::string(sweepPath) + "/" + network.topology() + ".bin";
+        network.serialize(path.c_str());
+
+        std::cout << separator << "    {\"topology\": \"" << network.topology() << "\""
+                  << ", \"parameters\": " << network.parameter_count()
+                  << ", \"model_bytes\": " << std::filesystem::file_size(path)
+                  << ", \"accuracy\": " << accuracy(network, testInputs, test)
+                  << ", \"latency_us_per_board\": " << microsecondsPerBoard(network, testInputs)
+                  << ", \"training_seconds\": " << trainingSeconds << "}";
+        separator = ",\n";
+    }
+    std::cout << "\n  ]\n"
+              << "}" << std::endl;
+    return 0;
+}
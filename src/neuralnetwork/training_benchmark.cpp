@@ -0,0 +1,107 @@
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <thread>
+
+#include "neuralnetwork.h"
+#include "dataset.h"
+
+// Benchmark of NeuralNetwork::train on 1, 2, 4... threads and on all the hardware ones, printed as JSON: the samples per
+// second of each thread count, its speedup over one thread, and whether two trainings with the same seed end with the
+// same weights. The samples are the characters of output/ when there are some, random binary characters otherwise.
+// usage: trainingbenchmark [epochs] [seed]
+
+constexpr int nbInputs = 28 * 28;
+constexpr int nbHiddens = 128;
+constexpr int nbOutputs = 26;
+constexpr int batchSize = 100;
+constexpr float learningRate = 0.01f;
+
+using Clock = std::chrono::steady_clock;
+
+std::vector<TrainingData> readSamples(unsigned seed)
+{
+    std::vector<TrainingData> samples;
+    std::vector<Data> data;
+    std::vector<cv::String> filepathes;
+    if (std::filesystem::is_directory("../output"))
+        readAllImages("../output/*.jpg", filepathes, data, nbOutputs);
+    for (auto &character: data)
+        samples.emplace_back(character.inputs, character.targets);
+
+    if (!samples.empty())
+        return samples;
+
+    cv::RNG random(seed);
+    for (int i = 0; i < 2000; ++i)
+    {
+        cv::Mat inputs(nbInputs, 1, CV_32FC1), targets = cv::Mat::zeros(nbOutputs, 1, CV_32FC1);
+        for (int k = 0; k < nbInputs; ++k)
+            inputs.at<float>(k, 0) = random.uniform(0, 3) == 0 ? 0.0f : 1.0f;
+        targets.at<float>(random.uniform(0, nbOutputs), 0) = 1.0f;
+        samples.emplace_back(inputs, targets);
+    }
+    return samples;
+}
+
+// a new network trained on samples, as the same seed always does it
+NeuralNetwork train(const std::vector<TrainingData> &samples, int epochs, unsigned threadCount, unsigned seed, double &seconds)
+{
+    cv::theRNG().state = seed;
+    NeuralNetwork network(nbInputs, nbHiddens, nbOutputs);
+    auto shuffled = samples;
+    auto start = Clock::now();
+    network.train(shuffled, epochs, batchSize, learningRate, threadCount, seed);
+    seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return network;
+}
+
+bool sameWeights(const NeuralNetwork &a, const NeuralNetwork &b)
+{
+    for (int k = 0; k < a.layer_count(); ++k)
+    {
+        if (cv::norm(a.m_weights[k], b.m_weights[k], cv::NORM_INF) != 0 || cv::norm(a.m_bias[k], b.m_bias[k], cv::NORM_INF) != 0)
+            return false;
+    }
+    return true;
+}
+
+int main(int argc, const char *argv[])
+{
+    int epochs = argc > 1 ? std::atoi(argv[1]) : 5;
+    unsigned seed = argc > 2 ? unsigned(std::stoul(argv[2])) : 0u;
+    auto samples = readSamples(seed);
+    // 1, 2, 4... threads, then all the hardware ones
+    unsigned hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<unsigned> threadCounts{1, 2, 4};
+    for (unsigned threadCount = 8; threadCount < hardwareThreads; threadCount *= 2)
+        threadCounts.push_back(threadCount);
+    if (hardwareThreads > threadCounts.back())
+        threadCounts.push_back(hardwareThreads);
+
+    std::cout << "{\n"
+              << "  \"samples\": " << samples.size() << ",\n"
+              << "  \"epochs\": " << epochs << ",\n"
+              << "  \"batch_size\": " << batchSize << ",\n"
+              << "  \"hardware_threads\": " << hardwareThreads << ",\n"
+              << "  \"threads\": [\n";
+    double singleThread = 0;
+    for (unsigned threadCount: threadCounts)
+    {
+        double seconds, secondsAgain;
+        auto network = train(samples, epochs, threadCount, seed, seconds);
+        auto again = train(samples, epochs, threadCount, seed, secondsAgain);
+        double samplesPerSecond = double(samples.size()) * epochs / std::min(seconds, secondsAgain);
+        if (threadCount == 1)
+            singleThread = samplesPerSecond;
+
+        std::cout << "    {\"threads\": " << threadCount
+                  << ", \"samples_per_second\": " << samplesPerSecond
+                  << ", \"speedup\": " << samplesPerSecond / singleThread
+                  << ", \"deterministic\": " << (sameWeights(network, again) ? "true" : "false") << "}"
+                  << (threadCount != threadCounts.back() ? ",\n" : "\n");
+    }
+    std::cout << "  ]\n"
+              << "}" << std::endl;
+    return 0;
+}
@@ -0,0 +1,156 @@
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+
+#include <sys/resource.h>
+
+#include "trie.h"
+#include "dawg.h"
+#include "solver.h"
+#include "rules.h"
+
+// Benchmark of the solver against french.txt, printed as JSON so runs can be compared:
+// timings of the dictionary load, trie and DAWG builds and image mapping, then solve latency and nodes
+// visited over seeded boards rolled with the french dice and over the real boards of images/.
+// usage: solutionerbenchmark [boardCount] [seed]
+
+constexpr const char *dictionaryPath = "../french.txt";
+constexpr const char *imagesPath = "../images";
+constexpr const char *imageOutputPath = "solutionerbenchmark.dawg";
+
+using Clock = std::chrono::steady_clock;
+
+double millisecondsSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+template<typename T>
+T percentile(std::vector<T> values, double ratio) {
+    if (values.empty())
+        return T();
+    auto index = size_t(ratio * double(values.size() - 1) + 0.5);
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+}
+
+// solve each board once and print the latency and nodes visited statistics as a JSON object
+void benchmarkBoards(const char *name, Solver &solver, const std::vector<char> &boards, bool isLast) {
+    size_t count = boards.size() / Solver::CellCount;
+    std::vector<double> latencies(count);
+    std::vector<size_t> visitedNodes(count);
+    size_t words = 0;
+    double total = 0;
+    for (size_t i = 0; i < count; ++i) {
+        auto start = Clock::now();
+        words += solver.solve(&boards[i * Solver::CellCount]).size();
+        latencies[i] = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+        visitedNodes[i] = solver.visitedNodes;
+        total += latencies[i];
+    }
+
+    size_t totalVisited = 0;
+    for (auto visited: visitedNodes) {
+        totalVisited += visited;
+    }
+
+    std::cout << "    \"" << name << "\": {\n"
+              << "      \"boards\": " << count << ",\n"
+              << "      \"boards_per_second\": " << double(count) / (total * 1e-6) << ",\n"
+              << "      \"latency_us\": {\"mean\": " << total / double(count)
+              << ", \"p50\": " << percentile(latencies, 0.5)
+              << ", \"p99\": " << percentile(latencies, 0.99)
+              << ", \"max\": " << percentile(latencies, 1.0) << "},\n"
+              << "      \"visited_nodes\": {\"mean\": " << double(totalVisited) / double(count)
+              << ", \"p50\": " << percentile(visitedNodes, 0.5)
+              << ", \"p99\": " << percentile(visitedNodes, 0.99) << "},\n"
+              << "      \"words_per_board\": " << double(words) / double(count) << "\n"
+              << "    }" << (isLast ? "" : ",") << "\n";
+}
+
+int main(int argc, const char *argv[]) {
+    size_t boardCount = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100000;
+    unsigned seed = argc > 2 ? unsigned(std::stoul(argv[2])) : 0u;
+
+    auto start = Clock::now();
+    std::vector<std::string> words;
+    if (!readWords(dictionaryPath, words)) {
+        std::cerr << "Could not read dictionary " << dictionaryPath << std::endl;
+        return 1;
+    }
+    double loadTime = millisecondsSince(start);
+
+    start = Clock::now();
+    auto trie = Trie::build(words);
+    double trieTime = millisecondsSince(start);
+
+    start = Clock::now();
+    auto builtDawg = Dawg::build(trie);
+    double dawgTime = millisecondsSince(start);
+
+    builtDawg.save(imageOutputPath);
+    start = Clock::now();
+    Dawg dawg;
+    if (!dawg.load(imageOutputPath)) {
+        std::cerr << "Could not map " << imageOutputPath << std::endl;
+        return 1;
+    }
+    double mapTime = millisecondsSince(start);
+
+    // seeded boards rolled with the french dice
+    std::vector<char> diceBoards(boardCount * Solver::CellCount);
+    std::mt19937 random(seed);
+    for (size_t i = 0; i < boardCount; ++i) {
+        rollBoard(random, &diceBoards[i * Solver::CellCount]);
+    }
+
+    // real boards: the images are named after their letters
+    std::vector<char> realBoards;
+    if (std::filesystem::is_directory(imagesPath)) {
+        for (const auto &entry: std::filesystem::directory_iterator(imagesPath)) {
+            auto name = entry.path().stem().string();
+            if (entry.path().extension() == ".jpg" && name.size() >= Solver::CellCount)
+                realBoards.insert(realBoards.end(), name.begin(), name.begin() + Solver::CellCount);
+        }
+    }
+
+    Solver solver(dawg);
+    std::cout << "{\n"
+              << "  \"dictionary\": {\n"
+              << "    \"words\": " << words.size() << ",\n"
+              << "    \"trie_nodes\": " << trie.nodes.size() << ",\n"
+              << "    \"dawg_nodes\": " << dawg.nodeCount << ",\n"
+              << "    \"dawg_edges\": " << dawg.edgeCount << ",\n"
+              << "    \"image_version\": " << DawgVersion << "\n"
+              << "  },\n"
+              << "  \"timings_ms\": {\n"
+              << "    \"load_words\": " << loadTime << ",\n"
+              << "    \"build_trie\": " << trieTime << ",\n"
+              << "    \"build_dawg\": " << dawgTime << ",\n"
+              << "    \"map_image\": " << mapTime << "\n"
+              << "  },\n"
+              << "  \"solve\": {\n";
+    benchmarkBoards("dice", solver, diceBoards, realBoards.empty());
+    if (!realBoards.empty())
+        benchmarkBoards("images", solver, realBoards, true);
+
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    long maxResidentKB = usage.ru_maxrss / 1024; // bytes on macOS
+#else
+    long maxResidentKB = usage.ru_maxrss;
+#endif
+    std::cout << "  },\n"
+              << "  \"memory_bytes\": {\n"
+              << "    \"trie\": " << trie.memoryFootprint() << ",\n"
+              << "    \"dawg\": " << dawg.memoryFootprint() << ",\n"
+              << "    \"trie_to_dawg_ratio\": " << double(trie.memoryFootprint()) / double(dawg.memoryFootprint()) << ",\n"
+              << "    \"solver\": " << sizeof(Solver) + solver.stamps.capacity() * sizeof(uint32_t)
+              + solver.solutions.capacity() * sizeof(Solver::Solution) << ",\n"
+              << "    \"max_resident\": " << maxResidentKB * 1024 << "\n"
+              << "  }\n"
+              << "}" << std::endl;
+
+    std::filesystem::remove(imageOutputPath);
+    return 0;
+}
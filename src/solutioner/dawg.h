@@ -0,0 +1,299 @@
+#ifndef DEBOGGLER_DAWG_H
+#define DEBOGGLER_DAWG_H
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <unordered_map>
+#include <vector>
+
+#include "trie.h"
+#include "mapped_file.h"
+
+// Binary dictionary image, usable in place once mapped in memory:
+//   DawgHeader | nodeCount * Dawg::Node | edgeCount * Dawg::Edge
+// checksum is the FNV-1a hash of the node and edge tables.
+// Bump DawgVersion whenever the layout of the header or of the tables changes.
+constexpr uint32_t DawgVersion = 3;
+
+struct DawgHeader {
+    char magic[4] = {'D', 'A', 'W', 'G'};
+    uint32_t version = DawgVersion;
+    uint32_t nodeCount = 0;
+    uint32_t edgeCount = 0;
+    uint32_t checksum = 0;
+    uint32_t wordCount = 0;
+};
+
+inline uint32_t fnv1a(const void *data, size_t size, uint32_t hash = 2166136261u) {
+    auto bytes = (const uint8_t *) data;
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+// Minimized directed acyclic word graph: a trie in which all the nodes accepting the same set of suffixes
+// are merged into one. French shares most of its endings ("-issions", "-eraient", ...) so this is
+// several times smaller than the trie (dawgcompiler prints both sizes and their ratio).
+// A node can now have several parents so children can't be stored contiguously: each node points to a
+// block of edges (one child per letter of its mask, in letter order) instead.
+// Each word also gets a unique index, its rank in alphabetical order: since the nodes are shared it can't be
+// a node index, so each edge stores how many words come before the words going through it, and the index of
+// a word is the sum of those offsets along its path (see descend).
+// Each node also summarizes the letters that every word below it still needs (requiredLetters): the solver
+// skips a node as soon as one of those letters is no longer available on the board.
+// The tables are accessed through plain pointers so they can either live in the storage vectors (built in
+// memory) or directly in a mapped dictionary image (see save and load).
+struct Dawg {
+    static constexpr uint32_t EndOfWordBit = Trie::EndOfWordBit;
+    static constexpr uint32_t NoNode = Trie::NoNode;
+    static constexpr uint32_t Root = 0;
+
+    struct Node {
+        uint32_t children = 0;  // bit i is set when the node has a child for letter i, bit 31 marks the end of a word
+        uint32_t firstEdge = 0; // index in edges of the child for the lowest letter, the others follow in letter order
+        uint32_t requiredLetters = 0; // bit i is set when all the words going through this node continue with letter i
+
+        [[nodiscard]] bool isEndOfWord() const { return children & EndOfWordBit; }
+
+        [[nodiscard]] bool hasChild(int letter) const { return children & (1u << letter); }
+    };
+
+    struct Edge {
+        uint32_t node = 0;       // index of the child
+        uint32_t wordOffset = 0; // number of words of the parent ordered before the words going through this edge
+    };
+
+    const Node *nodes = nullptr;
+    const Edge *edges = nullptr;
+    uint32_t nodeCount = 0;
+    uint32_t edgeCount = 0;
+    uint32_t wordCount = 0;
+
+    Dawg() = default;
+
+    Dawg(const Dawg &) = delete;
+
+    Dawg &operator=(const Dawg &) = delete;
+
+    // moving the storage vectors and the mapping keeps the table pointers valid
+    Dawg(Dawg &&) noexcept = default;
+
+    Dawg &operator=(Dawg &&) noexcept = default;
+
+    // index of the child of the given node for the given letter, or NoNode
+    [[nodiscard]] uint32_t child(uint32_t node, int letter) const {
+        const Node &current = nodes[node];
+        uint32_t bit = 1u << letter;
+        if (!(current.children & bit))
+            return NoNode;
+        return edges[current.firstEdge + popcount(current.children & (bit - 1))].node;
+    }
+
+    // move node to its child for the given letter and add the edge offset to wordIndex.
+    // Starting from Root with a wordIndex of 0, wordIndex is the index of the word once on its last node.
+    bool descend(uint32_t &node, uint32_t &wordIndex, int letter) const {
+        const Node &current = nodes[node];
+        uint32_t bit = 1u << letter;
+        if (!(current.children & bit))
+            return false;
+        const Edge &edge = edges[current.firstEdge + popcount(current.children & (bit - 1))];
+        node = edge.node;
+        wordIndex += edge.wordOffset;
+        return true;
+    }
+
+    // write the word of the given index in word (which must hold its letters and a terminating 0), return its length
+    int wordAt(uint32_t wordIndex, char *word) const {
+        uint32_t node = Root;
+        int length = 0;
+        while (!(nodes[node].isEndOfWord() && wordIndex == 0)) {
+            // the child to follow is the last one whose words start at or before the index
+            const Node &current = nodes[node];
+            uint32_t children = current.children & ~EndOfWordBit;
+            uint32_t edge = current.firstEdge;
+            int letter = __builtin_ctz(children);
+            for (uint32_t remaining = children & (children - 1); remaining != 0; remaining &= remaining - 1) {
+                if (edges[edge + 1].wordOffset > wordIndex)
+                    break;
+                edge++;
+                letter = __builtin_ctz(remaining);
+            }
+            word[length++] = char('a' + letter);
+            wordIndex -= edges[edge].wordOffset;
+            node = edges[edge].node;
+        }
+        word[length] = '\0';
+        return length;
+    }
+
+    [[nodiscard]] size_t memoryFootprint() const {
+        return nodeCount * sizeof(Node) + edgeCount * sizeof(Edge);
+    }
+
+    // Minimize the given trie.
+    // Method: - the trie is breadth-first so children always come after their parent: walking the nodes
+    //           backwards, the children of a node are already resolved to their equivalence class
+    //         - two nodes are equivalent when they have the same mask and the same children classes
+    //         - the classes are then renumbered breadth-first from the root to keep related nodes close
+    static Dawg build(const Trie &trie) {
+        struct SignatureHash {
+            size_t operator()(const std::vector<uint32_t> &signature) const {
+                size_t hash = signature.size();
+                for (auto value: signature) {
+                    hash ^= value + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+                }
+                return hash;
+            }
+        };
+
+        std::vector<uint32_t> classOf(trie.nodes.size());
+        std::vector<std::vector<uint32_t>> classes; // signature of each class: mask then children classes
+        std::unordered_map<std::vector<uint32_t>, uint32_t, SignatureHash> classIndices;
+        std::vector<uint32_t> signature;
+        for (size_t i = trie.nodes.size(); i-- > 0;) {
+            const auto &node = trie.nodes[i];
+            uint32_t childCount = popcount(node.children & ~EndOfWordBit);
+            signature.clear();
+            signature.push_back(node.children);
+            for (uint32_t k = 0; k < childCount; ++k) {
+                signature.push_back(classOf[node.firstChild + k]);
+            }
+
+            auto item = classIndices.find(signature);
+            if (item != classIndices.end()) {
+                classOf[i] = item->second;
+            } else {
+                classOf[i] = uint32_t(classes.size());
+                classIndices.emplace(signature, classOf[i]);
+                classes.push_back(signature);
+            }
+        }
+
+        Dawg dawg;
+        if (trie.nodes.empty()) {
+            dawg.nodeStorage.emplace_back();
+            dawg.bindStorage(0);
+            return dawg;
+        }
+
+        // number of words accepted from each class: children classes are always created before their parents
+        std::vector<uint32_t> wordCounts(classes.size());
+        for (size_t i = 0; i < classes.size(); ++i) {
+            wordCounts[i] = (classes[i][0] & EndOfWordBit) ? 1 : 0;
+            for (size_t k = 1; k < classes[i].size(); ++k) {
+                wordCounts[i] += wordCounts[classes[i][k]];
+            }
+        }
+
+        // letters needed by all the suffixes of each class: none if the class ends a word, otherwise the letters
+        // common to all its children (the letter of the child plus what the child requires)
+        std::vector<uint32_t> requiredLetters(classes.size());
+        for (size_t i = 0; i < classes.size(); ++i) {
+            uint32_t children = classes[i][0] & ~EndOfWordBit;
+            uint32_t required = (classes[i][0] & EndOfWordBit) ? 0 : ~0u;
+            for (size_t k = 1; k < classes[i].size(); ++k, children &= children - 1) {
+                required &= (1u << __builtin_ctz(children)) | requiredLetters[classes[i][k]];
+            }
+            requiredLetters[i] = classes[i].size() > 1 ? required : 0;
+        }
+
+        // renumber the classes breadth-first, the root first
+        std::vector<uint32_t> indexOf(classes.size(), NoNode);
+        std::vector<uint32_t> order;
+        order.reserve(classes.size());
+        indexOf[classOf[Trie::Root]] = 0;
+        order.push_back(classOf[Trie::Root]);
+        for (size_t i = 0; i < order.size(); ++i) {
+            const auto &current = classes[order[i]];
+            for (size_t k = 1; k < current.size(); ++k) {
+                if (indexOf[current[k]] == NoNode) {
+                    indexOf[current[k]] = uint32_t(order.size());
+                    order.push_back(current[k]);
+                }
+            }
+        }
+
+        dawg.nodeStorage.resize(order.size());
+        for (size_t i = 0; i < order.size(); ++i) {
+            const auto &current = classes[order[i]];
+            dawg.nodeStorage[i].children = current[0];
+            dawg.nodeStorage[i].firstEdge = uint32_t(dawg.edgeStorage.size());
+            dawg.nodeStorage[i].requiredLetters = requiredLetters[order[i]];
+            // the word ending on this node comes first, then the words of each child in letter order
+            uint32_t wordOffset = (current[0] & EndOfWordBit) ? 1 : 0;
+            for (size_t k = 1; k < current.size(); ++k) {
+                dawg.edgeStorage.push_back({indexOf[current[k]], wordOffset});
+                wordOffset += wordCounts[current[k]];
+            }
+        }
+        dawg.edgeStorage.shrink_to_fit();
+        dawg.bindStorage(wordCounts[classOf[Trie::Root]]);
+        return dawg;
+    }
+
+    // write the dictionary image
+    bool save(const char *path) const {
+        DawgHeader header;
+        header.nodeCount = nodeCount;
+        header.edgeCount = edgeCount;
+        header.checksum = checksum();
+        header.wordCount = wordCount;
+
+        std::ofstream fs(path, std::ios::out | std::ios::binary);
+        fs.write((const char *) &header, sizeof(DawgHeader));
+        fs.write((const char *) nodes, nodeCount * sizeof(Node));
+        fs.write((const char *) edges, edgeCount * sizeof(Edge));
+        fs.close();
+        return !fs.fail();
+    }
+
+    // map a dictionary image and use it in place, nothing is parsed or copied.
+    // Fails if the file is not an image of the current version, is truncated or is corrupted.
+    bool load(const char *path) {
+        MappedFile file;
+        if (!file.open(path) || file.size < sizeof(DawgHeader))
+            return false;
+
+        DawgHeader header;
+        std::memcpy(&header, file.data, sizeof(DawgHeader));
+        if (std::memcmp(header.magic, DawgHeader().magic, sizeof(header.magic)) != 0 || header.version != DawgVersion)
+            return false;
+        if (file.size != sizeof(DawgHeader) + header.nodeCount * sizeof(Node) + header.edgeCount * sizeof(Edge))
+            return false;
+
+        auto tables = (const uint8_t *) file.data + sizeof(DawgHeader);
+        if (fnv1a(tables, file.size - sizeof(DawgHeader)) != header.checksum)
+            return false;
+
+        nodeStorage.clear();
+        edgeStorage.clear();
+        mapping = std::move(file);
+        nodes = (const Node *) tables;
+        edges = (const Edge *) (tables + header.nodeCount * sizeof(Node));
+        nodeCount = header.nodeCount;
+        edgeCount = header.edgeCount;
+        wordCount = header.wordCount;
+        return true;
+    }
+
+    [[nodiscard]] uint32_t checksum() const {
+        return fnv1a(edges, edgeCount * sizeof(Edge), fnv1a(nodes, nodeCount * sizeof(Node)));
+    }
+
+private:
+    std::vector<Node> nodeStorage;
+    std::vector<Edge> edgeStorage;
+    MappedFile mapping;
+
+    void bindStorage(uint32_t words) {
+        nodes = nodeStorage.data();
+        edges = edgeStorage.data();
+        nodeCount = uint32_t(nodeStorage.size());
+        edgeCount = uint32_t(edgeStorage.size());
+        wordCount = words;
+    }
+};
+
+#endif //DEBOGGLER_DAWG_H
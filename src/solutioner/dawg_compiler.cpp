@@ -0,0 +1,32 @@
+#include <iostream>
+
+#include "trie.h"
+#include "dawg.h"
+
+// Compile a word list (one word per line) into a minimized DAWG image that the solutioner maps at startup
+// usage: dawgcompiler [words.txt] [output.dawg]
+int main(int argc, const char *argv[]) {
+    const char *wordsPath = argc > 1 ? argv[1] : "../french.txt";
+    const char *outputPath = argc > 2 ? argv[2] : "../android/app/src/main/assets/french.dawg";
+
+    std::vector<std::string> words;
+    if (!readWords(wordsPath, words)) {
+        std::cout << "Could not read dictionary " << wordsPath << std::endl;
+        return 1;
+    }
+
+    auto trie = Trie::build(words);
+    std::cout << "Trie: " << trie.nodes.size() << " nodes (" << trie.memoryFootprint() / 1024 << " KB)" << std::endl;
+
+    auto dawg = Dawg::build(trie);
+    std::cout << "Dawg: " << dawg.nodeCount << " nodes, " << dawg.edgeCount << " edges ("
+              << dawg.memoryFootprint() / 1024 << " KB, " << double(trie.memoryFootprint()) / double(dawg.memoryFootprint())
+              << " times smaller)" << std::endl;
+
+    if (!dawg.save(outputPath)) {
+        std::cout << "Could not write " << outputPath << std::endl;
+        return 1;
+    }
+    std::cout << "Written to " << outputPath << " (version " << DawgVersion << ")" << std::endl;
+    return 0;
+}
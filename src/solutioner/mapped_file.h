@@ -0,0 +1,65 @@
+#ifndef DEBOGGLER_MAPPED_FILE_H
+#define DEBOGGLER_MAPPED_FILE_H
+
+#include <cstddef>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Read-only memory mapping of a whole file, unmapped on destruction
+struct MappedFile {
+    const void *data = nullptr;
+    size_t size = 0;
+
+    MappedFile() = default;
+
+    MappedFile(const MappedFile &) = delete;
+
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    MappedFile(MappedFile &&other) noexcept
+            : data(std::exchange(other.data, nullptr)), size(std::exchange(other.size, 0)) {}
+
+    MappedFile &operator=(MappedFile &&other) noexcept {
+        if (this != &other) {
+            close();
+            data = std::exchange(other.data, nullptr);
+            size = std::exchange(other.size, 0);
+        }
+        return *this;
+    }
+
+    ~MappedFile() {
+        close();
+    }
+
+    bool open(const char *path) {
+        close();
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0)
+            return false;
+
+        struct stat info{};
+        if (fstat(fd, &info) == 0 && info.st_size > 0) {
+            void *address = mmap(nullptr, size_t(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (address != MAP_FAILED) {
+                data = address;
+                size = size_t(info.st_size);
+            }
+        }
+        ::close(fd); // the mapping stays valid once the descriptor is closed
+        return data != nullptr;
+    }
+
+    void close() {
+        if (data != nullptr)
+            munmap(const_cast<void *>(data), size);
+        data = nullptr;
+        size = 0;
+    }
+};
+
+#endif //DEBOGGLER_MAPPED_FILE_H
@@ -0,0 +1,51 @@
+#ifndef DEBOGGLER_RULES_H
+#define DEBOGGLER_RULES_H
+
+#include <algorithm>
+#include <random>
+
+// the 16 dice of the french Boggle
+constexpr const char *frenchDice[16] = {
+        "ETUKNO", "EVGTIN", "DECAMP", "IELRUW",
+        "EHIFSE", "RECALS", "ENTDOS", "OFXRIA",
+        "NAVEDZ", "EIOATA", "GLENYU", "BMAQJO",
+        "TLIBRA", "SPULTE", "AIMSOR", "ENHRIS",
+};
+
+// shake the dice: shuffle their positions and pick a random face for each of them
+template<typename RandomEngine>
+void rollBoard(RandomEngine &random, char board[16]) {
+    int order[16];
+    for (int i = 0; i < 16; ++i) {
+        order[i] = i;
+    }
+    std::shuffle(order, order + 16, random);
+    std::uniform_int_distribution<int> face(0, 5);
+    for (int i = 0; i < 16; ++i) {
+        board[i] = frenchDice[order[i]][face(random)];
+    }
+}
+
+// points scored by a word of the given length: the table of SolutionListAdapter.kt from 3 letters. The app falls
+// through to 11 points below 3 letters, those words are worth 0 here (french.txt has none anyway)
+inline int wordScore(int length) {
+    switch (length) {
+        case 0:
+        case 1:
+        case 2:
+            return 0;
+        case 3:
+        case 4:
+            return 1;
+        case 5:
+            return 2;
+        case 6:
+            return 3;
+        case 7:
+            return 5;
+        default:
+            return 11;
+    }
+}
+
+#endif //DEBOGGLER_RULES_H
@@ -0,0 +1,153 @@
+#ifndef DEBOGGLER_SOLVER_H
+#define DEBOGGLER_SOLVER_H
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#include "dawg.h"
+
+// smallest unsigned integer with one bit per cell of the board
+template<int CellCount>
+using CellMaskFor = std::conditional_t<(CellCount <= 16), uint16_t,
+        std::conditional_t<(CellCount <= 32), uint32_t, uint64_t>>;
+
+// neighbourMasks[i] has the bits of the (up to 8) cells adjacent to cell i
+template<typename CellMask, int Rows, int Cols>
+constexpr std::array<CellMask, Rows * Cols> computeNeighbourMasks() {
+    std::array<CellMask, Rows * Cols> masks{};
+    for (int i = 0; i < Rows; ++i) {
+        for (int j = 0; j < Cols; ++j) {
+            CellMask mask = 0;
+            for (int k = i - 1; k <= i + 1; ++k) {
+                for (int l = j - 1; l <= j + 1; ++l) {
+                    if (k >= 0 && k < Rows && l >= 0 && l < Cols && (k != i || l != j))
+                        mask |= CellMask(CellMask(1) << (k * Cols + l));
+                }
+            }
+            masks[i * Cols + j] = mask;
+        }
+    }
+    return masks;
+}
+
+// Depth-first search of all the dictionary words that can be spelled on a Rows x Cols board.
+// The board size is a compile-time parameter: the neighbour table and the width of the visited mask are
+// generated for each size, so the hot loop has no runtime size check (4x4, 5x5 Big Boggle, 6x6, ...).
+// The current DAWG node is carried down the recursion so each step is a single child lookup,
+// visited cells are a bitmask and the path being built lives in a fixed buffer.
+// Each word is reported once, with the first path found: stamps holds for each word the generation
+// of the last solve that found it, so checking and marking a word is O(1) and nothing is cleared between
+// boards. Once the solutions array has grown to its working size, solving a board allocates nothing.
+// The letters of the cells not visited yet are tracked as a histogram: a node whose requiredLetters are not
+// all still available can't lead to a word, so its whole subtree is skipped.
+template<int Rows, int Cols>
+struct BoardSolver {
+    static constexpr int CellCount = Rows * Cols;
+    static_assert(CellCount <= 64, "the visited cells must fit in a 64 bits mask");
+    using CellMask = CellMaskFor<CellCount>;
+
+    static constexpr std::array<CellMask, CellCount> neighbourMasks = computeNeighbourMasks<CellMask, Rows, Cols>();
+
+    // a word found on the board: its index in the dictionary (see Dawg::wordAt) and the cells spelling it
+    struct Solution {
+        uint32_t wordIndex;
+        uint8_t length;
+        uint8_t path[CellCount];
+    };
+
+    const Dawg &dawg;
+    std::vector<Solution> solutions;
+    std::vector<uint32_t> stamps;
+    uint32_t generation = 0;
+    size_t visitedNodes = 0; // dictionary nodes explored by the last solve
+    int letters[CellCount] = {};
+    uint8_t path[CellCount] = {};
+    int letterCounts[26] = {};     // number of cells not visited yet for each letter
+    uint32_t availableLetters = 0; // bit i is set when letterCounts[i] > 0
+
+    explicit BoardSolver(const Dawg &dawg) : dawg(dawg), stamps(dawg.wordCount, 0) {
+        solutions.reserve(256);
+    }
+
+    // Find all the words of the given board (CellCount characters, row by row)
+    const std::vector<Solution> &solve(const char *board) {
+        solutions.clear();
+        visitedNodes = 0;
+        if (++generation == 0) {
+            std::fill(stamps.begin(), stamps.end(), 0);
+            generation = 1;
+        }
+
+        // cells holding something else than a letter can never be part of a word
+        CellMask blocked = 0;
+        std::fill(std::begin(letterCounts), std::end(letterCounts), 0);
+        availableLetters = 0;
+        for (int i = 0; i < CellCount; ++i) {
+            letters[i] = letterIndex(board[i]);
+            if (letters[i] < 0) {
+                blocked |= bit(i);
+            } else {
+                letterCounts[letters[i]]++;
+                availableLetters |= 1u << letters[i];
+            }
+        }
+
+        for (int i = 0; i < CellCount; ++i) {
+            if (blocked & bit(i))
+                continue;
+            uint32_t node = Dawg::Root, wordIndex = 0;
+            if (dawg.descend(node, wordIndex, letters[i]))
+                visit(i, node, wordIndex, blocked, 0);
+        }
+        return solutions;
+    }
+
+private:
+    static constexpr CellMask bit(int cell) {
+        return CellMask(CellMask(1) << cell);
+    }
+
+    // take the letter of the cell out of the available ones and explore the node if its subtree can still match
+    void visit(int cell, uint32_t node, uint32_t wordIndex, CellMask visited, int depth) {
+        int letter = letters[cell];
+        if (--letterCounts[letter] == 0)
+            availableLetters &= ~(1u << letter);
+
+        if (!(dawg.nodes[node].requiredLetters & ~availableLetters))
+            searchFrom(cell, node, wordIndex, CellMask(visited | bit(cell)), depth);
+
+        if (letterCounts[letter]++ == 0)
+            availableLetters |= 1u << letter;
+    }
+
+    // node is the DAWG node of the current word, which ends with the letter of the given cell
+    void searchFrom(int cell, uint32_t node, uint32_t wordIndex, CellMask visited, int depth) {
+        path[depth] = uint8_t(cell);
+        visitedNodes++;
+
+        if (dawg.nodes[node].isEndOfWord() && stamps[wordIndex] != generation) {
+            stamps[wordIndex] = generation;
+            Solution &solution = solutions.emplace_back();
+            solution.wordIndex = wordIndex;
+            solution.length = uint8_t(depth + 1);
+            std::copy(path, path + depth + 1, solution.path);
+        }
+
+        CellMask candidates = neighbourMasks[cell] & ~visited;
+        while (candidates != 0) {
+            int next = __builtin_ctzll(candidates);
+            candidates &= candidates - 1;
+            uint32_t child = node, childWordIndex = wordIndex;
+            if (dawg.descend(child, childWordIndex, letters[next]))
+                visit(next, child, childWordIndex, visited, depth + 1);
+        }
+    }
+};
+
+// the classic 4x4 board
+using Solver = BoardSolver<4, 4>;
+
+#endif //DEBOGGLER_SOLVER_H
@@ -0,0 +1,133 @@
+#ifndef DEBOGGLER_TRIE_H
+#define DEBOGGLER_TRIE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// map a board or dictionary character to its letter index in [0, 26[, or -1 if it is not a plain latin letter
+inline int letterIndex(char c) {
+    int index = (c | 0x20) - 'a';
+    return index >= 0 && index < 26 ? index : -1;
+}
+
+inline uint32_t popcount(uint32_t value) {
+    return __builtin_popcount(value);
+}
+
+// read a word list (one word per line) and keep only the words made of plain latin letters, lowercased.
+// Words containing accents can never be spelled on a board so they are skipped.
+inline bool readWords(const char *path, std::vector<std::string> &words) {
+    std::ifstream fs(path);
+    if (!fs.is_open())
+        return false;
+
+    std::string word;
+    while (std::getline(fs, word)) {
+        if (!word.empty() && word.back() == '\r')
+            word.pop_back();
+        bool isValid = !word.empty();
+        for (size_t i = 0; i < word.size() && isValid; ++i) {
+            int letter = letterIndex(word[i]);
+            isValid = letter >= 0;
+            word[i] = char('a' + letter);
+        }
+        if (isValid)
+            words.push_back(word);
+    }
+    return true;
+}
+
+// Trie stored as a contiguous pool of nodes laid out breadth-first.
+// Each node holds the mask of the letters of its children and the index of its first child:
+// the children of a node are contiguous and sorted by letter, so the child for a given letter
+// is found with a popcount of the mask bits below it (no hashing, no pointer chasing).
+struct Trie {
+    static constexpr uint32_t EndOfWordBit = 1u << 31;
+    static constexpr uint32_t NoNode = ~0u;
+    static constexpr uint32_t Root = 0;
+
+    struct Node {
+        uint32_t children = 0;   // bit i is set when the node has a child for letter i, bit 31 marks the end of a word
+        uint32_t firstChild = 0; // index of the first child, the others follow in letter order
+
+        [[nodiscard]] bool isEndOfWord() const { return children & EndOfWordBit; }
+
+        [[nodiscard]] bool hasChild(int letter) const { return children & (1u << letter); }
+    };
+
+    std::vector<Node> nodes;
+
+    // index of the child of the given node for the given letter, or NoNode
+    [[nodiscard]] uint32_t child(uint32_t node, int letter) const {
+        const Node &current = nodes[node];
+        uint32_t bit = 1u << letter;
+        if (!(current.children & bit))
+            return NoNode;
+        return current.firstChild + popcount(current.children & (bit - 1));
+    }
+
+    // index of the node reached by the given word, or NoNode
+    [[nodiscard]] uint32_t search(const std::string &word) const {
+        uint32_t current = Root;
+        for (size_t i = 0; i < word.size() && current != NoNode; ++i) {
+            int letter = letterIndex(word[i]);
+            current = letter >= 0 ? child(current, letter) : NoNode;
+        }
+        return current;
+    }
+
+    [[nodiscard]] size_t memoryFootprint() const {
+        return nodes.capacity() * sizeof(Node);
+    }
+
+    // Build the trie from a list of lowercase words.
+    // Method: - sort the words: the words sharing a prefix then form a contiguous range
+    //         - each node is a range of words sharing the node prefix, processed in breadth-first order
+    //         - the children of a node are the sub-ranges sharing the next letter and are appended at the
+    //           end of the pool, which keeps siblings contiguous and the layout breadth-first
+    static Trie build(std::vector<std::string> words) {
+        std::sort(words.begin(), words.end());
+        words.erase(std::unique(words.begin(), words.end()), words.end());
+
+        struct Range {
+            uint32_t begin;
+            uint32_t end;
+            uint32_t depth;
+        };
+
+        Trie trie;
+        std::vector<Range> ranges;
+        ranges.push_back({0, uint32_t(words.size()), 0});
+        trie.nodes.emplace_back();
+        for (uint32_t i = 0; i < ranges.size(); ++i) {
+            const Range range = ranges[i];
+            uint32_t begin = range.begin;
+            // once sorted, the word equal to the prefix comes first
+            if (begin < range.end && words[begin].size() == range.depth) {
+                trie.nodes[i].children |= EndOfWordBit;
+                begin++;
+            }
+
+            trie.nodes[i].firstChild = uint32_t(trie.nodes.size());
+            while (begin < range.end) {
+                char c = words[begin][range.depth];
+                uint32_t end = begin + 1;
+                while (end < range.end && words[end][range.depth] == c) {
+                    end++;
+                }
+                trie.nodes[i].children |= 1u << letterIndex(c);
+                trie.nodes.emplace_back();
+                ranges.push_back({begin, end, range.depth + 1});
+                begin = end;
+            }
+        }
+
+        trie.nodes.shrink_to_fit();
+        return trie;
+    }
+};
+
+#endif //DEBOGGLER_TRIE_H
@@ -0,0 +1,164 @@
+#ifndef DEBOGGLER_WORK_STEALING_POOL_H
+#define DEBOGGLER_WORK_STEALING_POOL_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Runs a task for every index of [0, count[ on several threads.
+// Each worker owns a contiguous range of indices and takes small chunks from its front; a worker running
+// out of work steals the back half of the largest remaining range, so uneven tasks still keep all the
+// cores busy without a shared queue.
+// The threads are started once by the constructor and wait for the next run between two runs, so run can be
+// called for small tasks (a mini-batch, see NeuralNetwork::train) without creating and joining threads each time.
+// One run at a time: run must not be called concurrently nor from a task.
+struct WorkStealingPool {
+    static constexpr size_t ChunkSize = 64;
+
+    unsigned threadCount;
+
+    explicit WorkStealingPool(unsigned threadCount = std::thread::hardware_concurrency())
+            : threadCount(std::max(1u, threadCount)) {
+        for (unsigned i = 0; i < this->threadCount; ++i) {
+            ranges.push_back(std::make_unique<Range>());
+        }
+        for (unsigned i = 1; i < this->threadCount; ++i) {
+            threads.emplace_back(&WorkStealingPool::wait, this, i);
+        }
+    }
+
+    WorkStealingPool(const WorkStealingPool &) = delete;
+
+    WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+    ~WorkStealingPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        started.notify_all();
+        for (auto &thread: threads) {
+            thread.join();
+        }
+    }
+
+    // task(index, worker) with worker in [0, threadCount[: per-worker state can be indexed without locking.
+    // The calling thread is worker 0, run returns once every index is done.
+    template<typename Task>
+    void run(size_t count, Task &&task) {
+        for (unsigned i = 0; i < threadCount; ++i) {
+            ranges[i]->begin = count * i / threadCount;
+            ranges[i]->end = count * (i + 1) / threadCount;
+        }
+
+        auto work = [&task, this](unsigned worker) {
+            size_t begin, end;
+            while (pop(*ranges[worker], begin, end) || steal(ranges, worker, begin, end)) {
+                for (size_t i = begin; i < end; ++i) {
+                    task(i, worker);
+                }
+            }
+        };
+
+        using Work = decltype(work);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            job = [](void *work, unsigned worker) { (*static_cast<Work *>(work))(worker); };
+            jobWork = &work;
+            pending = threadCount - 1;
+            generation++;
+        }
+        started.notify_all();
+        work(0);
+
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.wait(lock, [this] { return pending == 0; });
+    }
+
+private:
+    struct Range {
+        std::mutex mutex;
+        size_t begin = 0;
+        size_t end = 0;
+    };
+
+    std::vector<std::unique_ptr<Range>> ranges;
+    std::vector<std::thread> threads;
+    // the run in progress: job calls the work of run (jobWork) for a worker, generation counts the runs
+    std::mutex mutex;
+    std::condition_variable started, finished;
+    void (*job)(void *, unsigned) = nullptr;
+    void *jobWork = nullptr;
+    unsigned generation = 0;
+    unsigned pending = 0;
+    bool stopping = false;
+
+    // loop of the worker threads: take part in each new run until the pool is destroyed
+    void wait(unsigned worker) {
+        unsigned done = 0;
+        while (true) {
+            void (*current)(void *, unsigned);
+            void *work;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                started.wait(lock, [&] { return stopping || generation != done; });
+                if (stopping)
+                    return;
+                done = generation;
+                current = job;
+                work = jobWork;
+            }
+            current(work, worker);
+
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--pending == 0)
+                finished.notify_one();
+        }
+    }
+
+    static bool pop(Range &range, size_t &begin, size_t &end) {
+        std::lock_guard<std::mutex> lock(range.mutex);
+        if (range.begin >= range.end)
+            return false;
+        begin = range.begin;
+        end = std::min(range.end, begin + ChunkSize);
+        range.begin = end;
+        return true;
+    }
+
+    // move the back half of the largest other range into the worker's own range, then pop from it
+    bool steal(std::vector<std::unique_ptr<Range>> &ranges, unsigned worker, size_t &begin, size_t &end) const {
+        while (true) {
+            unsigned victim = worker;
+            size_t largest = 0;
+            for (unsigned i = 0; i < threadCount; ++i) {
+                std::lock_guard<std::mutex> lock(ranges[i]->mutex);
+                size_t remaining = ranges[i]->end - ranges[i]->begin;
+                if (i != worker && remaining > largest) {
+                    largest = remaining;
+                    victim = i;
+                }
+            }
+            if (victim == worker)
+                return false;
+
+            {
+                std::scoped_lock lock(ranges[victim]->mutex, ranges[worker]->mutex);
+                auto &stolen = *ranges[victim];
+                if (stolen.end > stolen.begin) {
+                    size_t middle = stolen.begin + (stolen.end - stolen.begin) / 2;
+                    ranges[worker]->begin = middle;
+                    ranges[worker]->end = stolen.end;
+                    stolen.end = middle;
+                }
+            }
+            if (pop(*ranges[worker], begin, end))
+                return true;
+        }
+    }
+};
+
+#endif //DEBOGGLER_WORK_STEALING_POOL_H